@@ -23,20 +23,32 @@
 #include <wx/sizer.h>
 #endif
 
+#include <wx/stdpaths.h>
+
 #include "batchfile.hpp"
 #include "filesview.hpp"
-#include "model/execute.hpp"
-#include "model/ratios.hpp"
+#include "model/cache.hpp"
+#include "model/journal.hpp"
+#include "model/mesh_cache.hpp"
+#include "model/runner.hpp"
+#include "model/scheduler.hpp"
 #include "parametersview.hpp"
-#ifdef TBB_FOUND
-#include <tbb/parallel_for_each.h>
-#else
-#include <boost/range/algorithm/for_each.hpp>
-#endif //TBB_FOUND
 
 wxDEFINE_EVENT(wxEVT_BATCHFILE_LOADED, wxThreadEvent);
 wxDEFINE_EVENT(wxEVT_BATCHFILE_COMPUTED, wxThreadEvent);
-wxDEFINE_EVENT(wxEVT_BATCHFILE_STATUS_CHANGED, wxThreadEvent);
+
+// how often the statuses of the files are shown while running, in ms
+static constexpr int status_interval = 100;
+
+// shared by all tabs, so that its lock keeps them from appending to the same
+// file at once
+static ResultCache &result_cache() {
+  static ResultCache cache(
+      boost::filesystem::path(
+          wxStandardPaths::Get().GetUserLocalDataDir().ToStdWstring()) /
+      "cache");
+  return cache;
+}
 
 void BatchFile::Initialize() {
   using namespace std::string_literals;
@@ -49,7 +61,8 @@ void BatchFile::Initialize() {
 
   Bind(wxEVT_BATCHFILE_LOADED, &BatchFile::OnLoaded, this);
   Bind(wxEVT_BATCHFILE_COMPUTED, &BatchFile::OnComputed, this);
-  Bind(wxEVT_BATCHFILE_STATUS_CHANGED, &BatchFile::OnStatusChanged, this);
+  m_status_timer.SetOwner(this);
+  Bind(wxEVT_TIMER, &BatchFile::OnStatusTimer, this, m_status_timer.GetId());
 
   if (CreateThread(wxTHREAD_JOINABLE) == wxTHREAD_NO_ERROR)
     GetThread()->Run();
@@ -59,13 +72,15 @@ void BatchFile::Initialize() {
 
 void BatchFile::Compute() {
   using namespace std::string_literals;
+  m_cancelled = false;
   m_queue.Post(std::make_pair(RUN, ""s));
+  m_status_timer.Start(status_interval);
   SetRunning();
 }
 
+// OnComputed will stop running once the workers have noticed it
 void BatchFile::Cancel() {
   m_cancelled = true;
-  SetRunning(false);
 }
 
 void BatchFile::Save() {
@@ -79,11 +94,12 @@ void BatchFile::Save() {
   m_queue.Post(std::make_pair(SAVE, dialog.GetPath().ToStdString()));
 }
 
+BatchFile::~BatchFile() {
+}
+
 bool BatchFile::Cancelled() const { return m_cancelled; }
 
 wxThread::ExitCode BatchFile::Entry() {
-  using boost::irange;
-  using boost::adaptors::indexed;
   using boost::filesystem::path;
 
   Parameters parameters;
@@ -92,10 +108,11 @@ wxThread::ExitCode BatchFile::Entry() {
   const auto directory =
       path(m_fileName, std::codecvt_utf8<wchar_t>()).parent_path();
 
-  auto set_status = [this](std::size_t index, Status status) {
-    auto event = new wxThreadEvent(wxEVT_BATCHFILE_STATUS_CHANGED);
-    event->SetPayload(std::make_pair(index, status));
-    wxQueueEvent(GetEventHandler(), event);
+  std::atomic_bool failed = false;
+  auto set_status = [this, &failed](std::size_t index, Status status) {
+    if (status == STATUS_ERROR)
+      failed = true;
+    m_statuses.set(index, status);
   };
 
   std::pair<Event, std::string> event;
@@ -105,48 +122,33 @@ wxThread::ExitCode BatchFile::Entry() {
       load_batch_file(m_fileName, parameters, files);
       m_parameters_view->Update(parameters);
       m_files_view->UpdateFiles(files);
-      m_results.reserve(files.size());
-      for (const auto &file : files)
-        m_results[file];
+      m_results = Results(SignatureTable(parameter_signatures(parameters)),
+                          files);
+      // pick up where an interrupted run has stopped
+      m_journal = std::make_unique<Journal>(
+          path(m_fileName + ".journal", std::codecvt_utf8<wchar_t>()),
+          directory, true, m_results);
+      // the timer doesn't read the statuses before they are loaded
+      m_statuses.reset(files.size());
+      for (std::size_t index = 0; index < files.size(); ++index)
+        if (m_journal->completed(files[index]))
+          set_status(index, STATUS_OK);
       wxQueueEvent(GetEventHandler(),
                    new wxThreadEvent(wxEVT_BATCHFILE_LOADED));
       break;
-    case RUN: {
-      for (const auto &index : irange<typename std::vector<std::string>::size_type>(0ul, files.size()))
-        set_status(index, STATUS_WAITING);
-      auto runner = [&](const auto &file) {
-        set_status(file.index(), STATUS_RUNNING);
-        try {
-          Mesh mesh;
-          load_mesh(file.value(), mesh, directory);
-          const auto properties = mesh_properties(mesh);
-	  m_results.at(file.value()).area = properties[0];
-	  m_results.at(file.value()).volume = properties[1];
-	  m_results.at(file.value()).a = properties[2];
-	  m_results.at(file.value()).b = properties[3];
-	  m_results.at(file.value()).c = properties[4];
-	  m_results.at(file.value()).proj_circumference = properties[5];
-	  m_results.at(file.value()).proj_area = properties[6];
-	  m_results.at(file.value()).ratios = calculate_ratios(properties);
-          execute(file.value(), mesh, properties[0], properties[1], parameters,
-                  *this);
-          set_status(file.index(), STATUS_OK);
-        } catch (const std::exception& e) {
-	  std::cout << e.what() << std::endl;
-          set_status(file.index(), STATUS_ERROR);
-        } catch (...) {
-	  std::cout << "wtf" << std::endl;
-          set_status(file.index(), STATUS_ERROR);
-        }
-      };
-#ifdef TBB_FOUND
-      tbb::parallel_for_each(files | indexed(), runner);
-#else
-      boost::range::for_each(files | indexed(), runner);
-#endif //TBB_FOUND
+    case RUN:
+      failed = false;
+      shared_scheduler().run(Priority::BACKGROUND, [&] {
+        run_batch(directory, parameters, m_results, set_status,
+                  m_cancelled, &result_cache(), m_journal.get(),
+                  &shared_mesh_cache(), 2, &shared_memory_gate());
+      });
+      // nothing to resume, the next run computes every file again
+      if (!m_cancelled && !failed)
+        m_journal->clear();
       wxQueueEvent(GetEventHandler(),
                    new wxThreadEvent(wxEVT_BATCHFILE_COMPUTED));
-      break;}
+      break;
     case SAVE:
       save_batch_file(m_fileName, event.second, m_results);
       break;
@@ -160,52 +162,35 @@ wxThread::ExitCode BatchFile::Entry() {
 void BatchFile::OnLoaded(wxThreadEvent &WXUNUSED(event)) {
   m_parameters_view->Swap();
   m_files_view->SwapFiles();
+  ShowStatuses();
   GetSizer()->Layout();
   SetRunning(false);
 }
 
 void BatchFile::OnComputed(wxThreadEvent &WXUNUSED(event)) {
+  m_status_timer.Stop();
+  ShowStatuses();
   GetSizer()->Layout();
   SetRunning(false);
 }
 
-void BatchFile::OnStatusChanged(wxThreadEvent &event) {
-  const auto status = event.GetPayload<std::pair<std::size_t, Status>>();
-  m_files_view->UpdateStatus(status.first, status.second);
+void BatchFile::OnStatusTimer(wxTimerEvent &WXUNUSED(event)) {
+  ShowStatuses();
+}
+
+// only the rows that have changed since the last time are repainted
+void BatchFile::ShowStatuses() {
+  wxGridUpdateLocker lock(m_files_view);
+  m_statuses.changes([this](std::size_t index, Status status) {
+    m_files_view->UpdateStatus(index, status);
+  });
 }
 
 bool BatchFile::Destroy() {
   using namespace std::string_literals;
+  Cancel();
+  m_status_timer.Stop();
   m_queue.Post(std::make_pair(EXIT, ""s));
   GetThread()->Delete(nullptr, wxTHREAD_WAIT_BLOCK);
   return wxWindow::Destroy();
 }
-
-void BatchFile::su(const std::string &filename,
-                   const CenterSphereGenerator &center_sphere, int level_count,
-                   double area_ratio, Aggregation aggregation,
-                   std::pair<float, float> &su) {
-  const ParameterSignature signature(center_sphere.ratio, center_sphere.count,
-                                     level_count, area_ratio, aggregation);
-  m_results.at(filename).surm[signature].stable = su.first;
-  m_results.at(filename).surm[signature].unstable = su.second;
-}
-
-void BatchFile::reeb(const std::string &filename,
-                     const CenterSphereGenerator &center_sphere,
-                     int level_count, double area_ratio,
-                     Aggregation aggregation, const Graph &graph,
-                     const std::string &code) {
-  const ParameterSignature signature(center_sphere.ratio, center_sphere.count,
-                                     level_count, area_ratio, aggregation);
-  m_results.at(filename).surm[signature].reeb = code;
-}
-
-void BatchFile::morse(const std::string &filename,
-                      const CenterSphereGenerator &center_sphere,
-                      int level_count, double area_ratio,
-                      Aggregation aggregation, const std::string &code) {
-  const ParameterSignature signature(center_sphere.ratio, center_sphere.count,
-                                     level_count, area_ratio, aggregation);
-  m_results.at(filename).surm[signature].morse = code;
-}
@@ -21,24 +21,28 @@
 #define BATCH_FILE_HPP
 
 #include <atomic>
+#include <memory>
 #include <wx/msgqueue.h>
+#include <wx/timer.h>
 #include "computable.hpp"
 #include "model/primitives.hpp"
 #include "model/batch.hpp"
+#include "model/status_board.hpp"
 
+class Journal;
 class ParametersView;
 class FilesView;
 class wxAuiNotebookEvent;
 
 wxDECLARE_EVENT(wxEVT_BATCHFILE_LOADED, wxThreadEvent);
 wxDECLARE_EVENT(wxEVT_BATCHFILE_COMPUTED, wxThreadEvent);
-wxDECLARE_EVENT(wxEVT_BATCHFILE_STATUS_CHANGED, wxThreadEvent);
 
 class BatchFile final : public wxWindow, public wxThreadHelper, public Computable {
   const std::string m_fileName;
 
   // accessed from background thread only
   Results m_results;
+  std::unique_ptr<Journal> m_journal;
 
   ParametersView *m_parameters_view;
   FilesView *m_files_view;
@@ -52,12 +56,17 @@ class BatchFile final : public wxWindow, public wxThreadHelper, public Computabl
   wxMessageQueue<std::pair<Event, std::string> > m_queue;
 
   std::atomic_bool m_cancelled = false;
+
+  // written by the workers, shown by the timer while running
+  StatusBoard m_statuses;
+  wxTimer m_status_timer;
   
   void Initialize();
   wxThread::ExitCode Entry() final;
   void OnLoaded(wxThreadEvent &event);
   void OnComputed(wxThreadEvent &event);
-  void OnStatusChanged(wxThreadEvent &event);
+  void OnStatusTimer(wxTimerEvent &event);
+  void ShowStatuses();
   bool Cancelled() const;
 public:
   template <typename... Args>
@@ -70,38 +79,8 @@ public:
   void Cancel() final;
   void Save() final;
   bool Destroy() final;
-  virtual ~BatchFile() {
-  }
+  virtual ~BatchFile();
 
-  // Saver concept
-  /*void mesh_properties(const std::string &filename,
-		       double area,
-		       double volume);*/
-  void level_graph(const std::string &filename,
-		   const CenterSphereGenerator &center_sphere,
-		   int level_count,
-		   const Graph &graph,
-		   const std::vector<GraphEdge> &stable_edges,
-		   const std::vector<GraphEdge> &unstable_edges) {};
-  void su(const std::string &filename,
-	  const CenterSphereGenerator &center_sphere,
-	  int level_count,
-	  double area_ratio,
-	  Aggregation aggregation,
-	  std::pair<float, float> &su);
-  void reeb(const std::string &filename,
-	    const CenterSphereGenerator &center_sphere,
-	    int level_count,
-	    double area_ratio,
-	    Aggregation aggregation,
-	    const Graph &graph,
-	    const std::string &code);
-  void morse(const std::string &filename,
-	     const CenterSphereGenerator &center_sphere,
-	     int level_count,
-	     double area_ratio,
-	     Aggregation aggregation,
-	     const std::string &code);
 };
 
 #endif // BATCH_FILE_HPP
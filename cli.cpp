@@ -0,0 +1,195 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+#include <csignal>
+#include <dependencies.hpp>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#ifdef TBB_FOUND
+#include <tbb/global_control.h>
+#endif //TBB_FOUND
+
+#include "model/batch.hpp"
+#include "model/cache.hpp"
+#include "model/journal.hpp"
+#include "model/runner.hpp"
+
+static const char *status_labels[] = {"waiting", "running", "ok", "error",
+                                       "cancelled"};
+
+static std::atomic_bool cancelled = false;
+
+static void on_interrupt(int) {
+  cancelled = true;
+  // a second interrupt terminates immediately
+  std::signal(SIGINT, SIG_DFL);
+}
+
+// "ratio;count;level count;area ratio;aggregation" in the units of a batch file
+static ParameterSignature parse_parameter(const std::string &parameter) {
+  const boost::escaped_list_separator<char> separator('\\', ';', '\"');
+  boost::tokenizer<boost::escaped_list_separator<char>> tokenizer(parameter,
+                                                                  separator);
+  std::vector<std::string> fields(tokenizer.begin(), tokenizer.end());
+  if (fields.size() != 5)
+    throw std::invalid_argument("invalid parameter: " + parameter);
+  // accept the decimal comma of the batch files too
+  boost::replace_all(fields[0], ",", ".");
+  boost::replace_all(fields[3], ",", ".");
+  return ParameterSignature(std::stod(fields[0]) / 100.0,
+			    std::stoi(fields[1]),
+			    std::stoi(fields[2]),
+			    std::stod(fields[3]) / 100.0,
+			    parse_aggregation(fields[4]));
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+  using boost::filesystem::path;
+
+  std::string output, cache_directory;
+  std::vector<std::string> inputs, parameter_strings;
+  int threads = 0;
+  std::size_t read_ahead = 2;
+  std::size_t memory = default_memory_budget() >> 20;
+  bool quiet = false, resume = false;
+
+  po::options_description visible("Usage: contours_cli [options] <batch.csv | mesh...>\n\nOptions");
+  visible.add_options()
+    ("help,h", "print this message")
+    ("output,o", po::value(&output)->required(), "CSV file to write the results to")
+    ("parameter,p", po::value(&parameter_strings),
+     "\"ratio;count;level count;area ratio;aggregation\" for mesh inputs, can be repeated")
+    ("threads,j", po::value(&threads), "number of worker threads (default: all cores)")
+    ("read-ahead", po::value(&read_ahead),
+     "number of files to read while others are computed (default: 2)")
+    ("memory,m", po::value(&memory),
+     "MB of memory the files computed at the same time may take, 0 for no limit (default: half of the physical memory)")
+    ("cache,c", po::value(&cache_directory),
+     "directory to reuse results of earlier runs from")
+    ("resume,r", po::bool_switch(&resume),
+     "skip the files that an interrupted run has already finished")
+    ("quiet,q", po::bool_switch(&quiet), "do not report the status of the files");
+  po::options_description hidden;
+  hidden.add_options()
+    ("input", po::value(&inputs));
+  po::options_description all;
+  all.add(visible).add(hidden);
+  po::positional_options_description positional;
+  positional.add("input", -1);
+
+  try {
+    po::variables_map variables;
+    po::store(po::command_line_parser(argc, argv)
+	      .options(all)
+	      .positional(positional)
+	      .run(),
+	      variables);
+    if (variables.count("help")) {
+      std::cout << visible << std::endl;
+      return 0;
+    }
+    po::notify(variables);
+    if (inputs.empty())
+      throw std::invalid_argument("no input files");
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n\n" << visible << std::endl;
+    return 2;
+  }
+
+#ifdef TBB_FOUND
+  std::unique_ptr<tbb::global_control> control;
+  if (threads > 0)
+    control = std::make_unique<tbb::global_control>(
+	tbb::global_control::max_allowed_parallelism, threads);
+#endif //TBB_FOUND
+
+  // a single CSV is a batch file, anything else is a list of meshes
+  const bool batch = inputs.size() == 1 &&
+    path(inputs[0]).extension() == ".csv";
+
+  Parameters parameters;
+  std::vector<std::string> files;
+  std::vector<ParameterSignature> signatures;
+  path directory;
+  try {
+    if (batch) {
+      load_batch_file(inputs[0], parameters, files);
+      directory = path(inputs[0]).parent_path();
+    } else {
+      if (parameter_strings.empty())
+	throw std::invalid_argument("at least one parameter is required for mesh inputs");
+      for (const auto &parameter : parameter_strings) {
+	signatures.push_back(parse_parameter(parameter));
+	insert_signature(parameters, signatures.back());
+      }
+      files = inputs;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 2;
+  }
+
+  std::unique_ptr<ResultCache> cache;
+  if (!cache_directory.empty())
+    cache = std::make_unique<ResultCache>(cache_directory);
+
+  std::signal(SIGINT, on_interrupt);
+
+  Results results(SignatureTable(parameter_signatures(parameters)), files);
+  // the finished files are checkpointed next to the output
+  const path journal_file(output + ".journal");
+  Journal journal(journal_file, directory, resume, results);
+
+  std::mutex mutex;
+  bool failed = false;
+  auto set_status = [&](std::size_t index, Status status) {
+    if (status == STATUS_WAITING)
+      return;
+    std::lock_guard<std::mutex> lock(mutex);
+    failed = failed || status == STATUS_ERROR;
+    if (!quiet)
+      std::cerr << status_labels[status] << ' ' << files[index] << '\n';
+  };
+  shared_memory_gate().set_budget(memory << 20);
+  const auto statistics = run_batch(directory, parameters, results,
+				    set_status, cancelled, cache.get(),
+				    &journal, nullptr, read_ahead,
+				    &shared_memory_gate());
+  if (!quiet && statistics.points > 0)
+    std::cerr << "read " << statistics.points << " points from "
+	      << statistics.bytes / 1e6 << " MB at "
+	      << statistics.throughput() << " MB/s\n";
+
+  if (batch)
+    save_batch_file(inputs[0], output, results);
+  else
+    save_results(output, signatures, results);
+
+  if (cancelled)
+    return 130;
+  if (!failed)
+    boost::filesystem::remove(journal_file);
+  return failed ? 1 : 0;
+}
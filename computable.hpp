@@ -34,6 +34,10 @@ public:
   virtual void Compute() = 0;
   virtual void Cancel() = 0;
   virtual void Save() = 0;
+  // Tabs that are expensive to load do so when they are first shown, and
+  // may prepare in the background when they are likely to be shown soon.
+  virtual void Activate() {}
+  virtual void Prefetch() {}
   bool Running() const {
 	return m_running;
   }
@@ -23,7 +23,7 @@
 static constexpr const char* labels[] = {"File name", "Status"};
 static constexpr const char* types[] = {"string", "string"};
 static constexpr std::size_t label_count = sizeof(labels) / sizeof(const char*);
-static constexpr const char* status_labels[] = {"Waiting", "Running", "OK", "Error"};
+static constexpr const char* status_labels[] = {"Waiting", "Running", "OK", "Error", "Cancelled"};
 
 void FilesView::Initialize() {
   CreateGrid(0, label_count);
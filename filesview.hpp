@@ -23,13 +23,7 @@
 #include <wx/grid.h>
 #include <wx/thread.h>
 #include <vector>
-
-enum Status {
-  STATUS_WAITING,
-  STATUS_RUNNING,
-  STATUS_OK,
-  STATUS_ERROR
-};
+#include "model/batch.hpp"
 
 class FilesView final : public wxGrid {
   wxCriticalSection m_critical_section;
@@ -107,7 +107,7 @@ void GraphView::Initialize() {
   interactor->Enable();
 }
 
-void GraphView::UpdateGraph(const Graph &reeb) {
+void GraphView::UpdateGraph(const ReebGraph &reeb) {
   wxCriticalSectionLocker lock(m_critical_section);
   vtkNew<vtkMutableDirectedGraph> graph;
 
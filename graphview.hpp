@@ -25,9 +25,7 @@
 #include <vtkGraphLayoutView.h>
 
 #include "wxVTKWidget.hpp"
-//#include "reebgraph.hpp"
-
-#include "model/primitives.hpp"
+#include "model/reeb.hpp"
 
 class GraphView final : public wxVTKWidget {
   wxCriticalSection m_critical_section;
@@ -41,7 +39,7 @@ public:
     Initialize();
   }
 
-  void UpdateGraph(const Graph &reeb);
+  void UpdateGraph(const ReebGraph &reeb);
   void Swap();
 };
 
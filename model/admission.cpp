@@ -0,0 +1,112 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "admission.hpp"
+
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#endif
+
+MemoryGate::Admission &
+MemoryGate::Admission::operator=(Admission &&other) noexcept {
+  if (this != &other) {
+    if (m_gate)
+      m_gate->release(m_bytes);
+    m_gate = other.m_gate;
+    m_bytes = other.m_bytes;
+    other.m_gate = nullptr;
+  }
+  return *this;
+}
+
+MemoryGate::Admission::~Admission() {
+  if (m_gate)
+    m_gate->release(m_bytes);
+}
+
+MemoryGate::MemoryGate(const std::size_t budget) : m_budget(budget) {}
+
+void MemoryGate::release(const std::size_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_used -= bytes;
+  }
+  m_released.notify_all();
+}
+
+MemoryGate::Admission MemoryGate::admit(const std::size_t bytes,
+				       const std::size_t threads) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_waiting + 1 < threads) {
+    ++m_waiting;
+    m_released.wait(lock, [this, bytes] {
+      return m_budget == 0 || m_used == 0 || m_used + bytes <= m_budget;
+    });
+    --m_waiting;
+  }
+  m_used += bytes;
+  return Admission(this, bytes);
+}
+
+void MemoryGate::set_budget(const std::size_t budget) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = budget;
+  }
+  m_released.notify_all();
+}
+
+FootprintEstimate::FootprintEstimate(const Parameters &parameters) {
+  // the raw points and the hull take a few times the file, and the
+  // intersection tables grow with the levels
+  int levels = 0;
+  for (const auto &center_sphere : parameters)
+    for (const auto &level_count : center_sphere.next)
+      levels += level_count.value + 1;
+  m_guess = 4.0 * (1.0 + levels / 64.0);
+}
+
+std::size_t FootprintEstimate::operator()(const std::uintmax_t file_size) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // weighted by size, so that the overhead of tiny files doesn't dominate
+  const double ratio = m_bytes > 0.0 ? m_measured / m_bytes : m_guess;
+  return static_cast<std::size_t>(ratio * file_size);
+}
+
+void FootprintEstimate::measured(const std::uintmax_t file_size,
+				 const std::size_t footprint) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_measured += footprint;
+  m_bytes += file_size;
+}
+
+std::size_t default_memory_budget() {
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+  const auto pages = sysconf(_SC_PHYS_PAGES);
+  const auto page_size = sysconf(_SC_PAGESIZE);
+  if (pages > 0 && page_size > 0)
+    return static_cast<std::size_t>(pages) * page_size / 2;
+#endif
+  return 0;
+}
+
+MemoryGate &shared_memory_gate() {
+  static MemoryGate gate(default_memory_budget());
+  return gate;
+}
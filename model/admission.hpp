@@ -0,0 +1,92 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_ADMISSION_HPP
+#define MODEL_ADMISSION_HPP 1
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "parameters.hpp"
+
+// Lets files into a batch only while their estimated memory fits into the
+// budget along with the ones already running. A file that doesn't fit even
+// alone is let in once nothing else runs.
+class MemoryGate {
+  std::mutex m_mutex;
+  std::condition_variable m_released;
+  std::size_t m_budget;
+  std::size_t m_used = 0;
+  // threads blocked in admit
+  std::size_t m_waiting = 0;
+
+  void release(std::size_t bytes);
+public:
+  // holds its bytes of the budget until destroyed
+  class Admission {
+    MemoryGate *m_gate = nullptr;
+    std::size_t m_bytes = 0;
+  public:
+    Admission() = default;
+    Admission(MemoryGate *gate, std::size_t bytes) :
+      m_gate(gate), m_bytes(bytes) {}
+    Admission(Admission &&other) noexcept :
+      m_gate(other.m_gate), m_bytes(other.m_bytes) {
+      other.m_gate = nullptr;
+    }
+    Admission &operator=(Admission &&other) noexcept;
+    ~Admission();
+  };
+
+  // no limit if budget is 0
+  explicit MemoryGate(std::size_t budget);
+  MemoryGate(const MemoryGate &) = delete;
+  MemoryGate &operator=(const MemoryGate &) = delete;
+
+  // Blocks until bytes fit. The files admitted before are run by the other
+  // threads, so the last waiting one of threads is let in anyway.
+  Admission admit(std::size_t bytes, std::size_t threads);
+  void set_budget(std::size_t budget);
+};
+
+// The peak memory of a file in bytes per byte of the mesh file. It starts
+// from a rough guess by the parameters, and the footprints measured replace
+// it as the files finish.
+class FootprintEstimate {
+  mutable std::mutex m_mutex;
+  double m_guess;
+  double m_measured = 0.0;
+  double m_bytes = 0.0;
+public:
+  explicit FootprintEstimate(const Parameters &parameters);
+
+  std::size_t operator()(std::uintmax_t file_size) const;
+  void measured(std::uintmax_t file_size, std::size_t footprint);
+};
+
+// half of the physical memory, 0 if it is not known
+std::size_t default_memory_budget();
+
+// the gate of the application, shared by the batches running at the same
+// time, with the default budget until set_budget is called
+MemoryGate &shared_memory_gate();
+
+#endif // MODEL_ADMISSION_HPP
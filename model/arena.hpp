@@ -0,0 +1,145 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_ARENA_HPP
+#define MODEL_ARENA_HPP 1
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// The resource that containers of the level graphs allocate from on this
+// thread, set by ArenaScope.
+inline thread_local std::pmr::memory_resource *current_arena_resource = nullptr;
+
+inline std::pmr::memory_resource *current_arena() {
+  return current_arena_resource ? current_arena_resource
+    : std::pmr::new_delete_resource();
+}
+
+// Allocates from the arena that is current when the container is created
+// (or copied), so containers deep inside the graph don't need to be handed
+// a resource explicitly.
+template <typename T>
+class ArenaAllocator {
+  std::pmr::memory_resource *m_resource;
+public:
+  using value_type = T;
+
+  ArenaAllocator() noexcept : m_resource(current_arena()) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept :
+    m_resource(other.resource()) {}
+
+  T *allocate(const std::size_t n) {
+    return static_cast<T *>(m_resource->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *pointer, const std::size_t n) noexcept {
+    m_resource->deallocate(pointer, n * sizeof(T), alignof(T));
+  }
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+  std::pmr::memory_resource *resource() const noexcept {
+    return m_resource;
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> &other) const noexcept {
+    return m_resource == other.resource();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U> &other) const noexcept {
+    return m_resource != other.resource();
+  }
+};
+
+// Monotonic memory for one level graph at a time. Whatever doesn't fit into
+// the buffer comes from the heap, and the buffer grows by that much on the
+// next reset, so after a few iterations building a graph doesn't call malloc.
+class Arena {
+  class Upstream final : public std::pmr::memory_resource {
+    std::size_t m_allocated = 0;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) final {
+      m_allocated += bytes;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) final {
+      std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept final {
+      return this == &other;
+    }
+  public:
+    std::size_t allocated() const { return m_allocated; }
+    void clear() { m_allocated = 0; }
+  };
+
+  Upstream m_upstream;
+  std::unique_ptr<std::byte[]> m_buffer;
+  std::size_t m_size = 0;
+  std::optional<std::pmr::monotonic_buffer_resource> m_resource;
+public:
+  Arena() {
+    m_resource.emplace(&m_upstream);
+  }
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  std::pmr::memory_resource *resource() {
+    return &*m_resource;
+  }
+  // the size of the buffer, the most a graph has needed so far
+  std::size_t capacity() const {
+    return m_size;
+  }
+  // releases everything allocated since the last reset
+  void reset() {
+    const auto overflow = m_upstream.allocated();
+    m_resource.reset();
+    if (overflow > 0) {
+      m_size += overflow;
+      m_buffer.reset(new std::byte[m_size]);
+    }
+    m_upstream.clear();
+    m_resource.emplace(m_buffer.get(), m_size, &m_upstream);
+  }
+};
+
+// Makes arena current on this thread, and resets it when the scope ends.
+// Everything allocated from it has to be destroyed by then.
+class ArenaScope {
+  Arena &m_arena;
+  std::pmr::memory_resource *m_previous;
+public:
+  explicit ArenaScope(Arena &arena) :
+    m_arena(arena), m_previous(current_arena_resource) {
+    current_arena_resource = arena.resource();
+  }
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+  ~ArenaScope() {
+    current_arena_resource = m_previous;
+    m_arena.reset();
+  }
+};
+
+#endif // MODEL_ARENA_HPP
@@ -20,7 +20,10 @@
 #include "batch.hpp"
 
 #include <boost/range/adaptor/indexed.hpp>
+#include <iostream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 static std::vector<std::vector<std::string>>
 parse_csv(const std::string &file) {
@@ -73,6 +76,127 @@ static std::string to_string_coma(const double number) {
   return stream.str();
 }
 
+static constexpr const char *aggregation_names[] = {"elso", "atlag", "smin",
+							 "smax", "umin", "umax"};
+
+Aggregation parse_aggregation(const std::string &name) {
+  if (name.find("atlag") != std::string::npos)
+    return AVERAGE;
+  else if (name.find("smin") != std::string::npos)
+    return SMIN;
+  else if (name.find("smax") != std::string::npos)
+    return SMAX;
+  else if (name.find("umin") != std::string::npos)
+    return UMIN;
+  else if (name.find("umax") != std::string::npos)
+    return UMAX;
+  return FIRST;
+}
+
+static ParameterSignature parse_signature(const std::vector<std::string> &row) {
+  return ParameterSignature(stod_coma(row.at(1)) / 100.0,
+			    std::stoi(row.at(2)),
+			    std::stoi(row.at(3)),
+			    stod_coma(row.at(4)) / 100.0,
+			    parse_aggregation(row.at(5)));
+}
+
+void insert_signature(Parameters &parameters,
+		      const ParameterSignature &signature) {
+  const auto &[ratio, count, level_count, area_ratio, aggr] = signature;
+  CenterSphereGenerator generator;
+  generator.ratio = ratio;
+  generator.count = count;
+
+  auto c_s_it = boost::find_if(parameters, [&generator](const auto &g) {
+    return g.value == generator;
+  });
+  if (c_s_it == parameters.end())
+    c_s_it = parameters.insert(c_s_it, CenterSphere{generator});
+
+  auto l_c_it = boost::find_if(c_s_it->next, [&level_count](const auto &l) {
+    return l.value == level_count;
+  });
+  if (l_c_it == c_s_it->next.end())
+    l_c_it = c_s_it->next.insert(l_c_it, LevelCount{level_count});
+
+  auto a_r_it = boost::find_if(l_c_it->next, [&area_ratio](const auto &a) {
+    return a.value == area_ratio;
+  });
+  if (a_r_it == l_c_it->next.end())
+    a_r_it = l_c_it->next.insert(a_r_it, AreaRatio{area_ratio});
+
+  auto aggr_it = boost::find(a_r_it->next, aggr);
+  if (aggr_it == a_r_it->next.end())
+    a_r_it->next.insert(aggr_it, aggr);
+}
+
+std::vector<ParameterSignature> parameter_signatures(const Parameters &parameters) {
+  std::vector<ParameterSignature> result;
+  for (const auto &center_sphere : parameters)
+    for (const auto &level_count : center_sphere.next)
+      for (const auto &area_ratio : level_count.next)
+	for (const auto &aggregation : area_ratio.next)
+	  result.emplace_back(center_sphere.value.ratio,
+			      center_sphere.value.count,
+			      level_count.value,
+			      area_ratio.value,
+			      aggregation);
+  return result;
+}
+
+SignatureTable::SignatureTable(const std::vector<ParameterSignature> &signatures) {
+  m_slots.reserve(signatures.size());
+  for (const auto &signature : signatures)
+    if (m_slots.emplace(signature, m_signatures.size()).second)
+      m_signatures.push_back(signature);
+}
+
+std::size_t SignatureTable::find(const ParameterSignature &signature) const {
+  const auto slot = m_slots.find(signature);
+  return slot != m_slots.end() ? slot->second : npos;
+}
+
+std::vector<std::size_t> SignatureTable::slots(const Parameters &parameters) const {
+  std::vector<std::size_t> result;
+  for (const auto &signature : parameter_signatures(parameters))
+    result.push_back(m_slots.at(signature));
+  return result;
+}
+
+CodePool::CodePool() {
+  intern(std::string());
+}
+
+CodePool::Id CodePool::intern(const std::string &code) {
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const auto id = m_ids.find(code);
+    if (id != m_ids.end())
+      return id->second;
+  }
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  // another thread may have added it in the meantime
+  const auto id = m_ids.find(code);
+  if (id != m_ids.end())
+    return id->second;
+  m_codes.push_back(code);
+  return m_ids.emplace(m_codes.back(), m_codes.size() - 1).first->second;
+}
+
+const std::string &CodePool::operator[](const Id id) const {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return m_codes.at(id);
+}
+
+Results::Results(SignatureTable signatures, std::vector<std::string> files) :
+  signatures(std::move(signatures)),
+  files(std::move(files)),
+  data(this->files.size()) {
+  for (auto &file : data)
+    file.surm.resize(this->signatures.size());
+}
+
 void load_batch_file(const std::string &batch_file, Parameters &parameters,
                      std::vector<std::string> &files) {
   const auto table = parse_csv(batch_file);
@@ -85,48 +209,8 @@ void load_batch_file(const std::string &batch_file, Parameters &parameters,
       ;
     row += 3; // skip empty row and header
     // parameters until empty row
-    for (; !(table.at(row).empty() || table.at(row).at(0).empty()); ++row) {
-      // convert to the right type
-      CenterSphereGenerator generator;
-      generator.ratio = stod_coma(table.at(row).at(1)) / 100.0;
-      generator.count = std::stoi(table.at(row).at(2));
-      const auto level_count = std::stoi(table.at(row).at(3));
-      const auto area_ratio = stod_coma(table.at(row).at(4)) / 100.0;
-      Aggregation aggr = FIRST;
-      if (table.at(row).at(5).find("atlag") != std::string::npos)
-        aggr = AVERAGE;
-      else if (table.at(row).at(5).find("smin") != std::string::npos)
-        aggr = SMIN;
-      else if (table.at(row).at(5).find("smax") != std::string::npos)
-        aggr = SMAX;
-      else if (table.at(row).at(5).find("umin") != std::string::npos)
-        aggr = UMIN;
-      else if (table.at(row).at(5).find("umax") != std::string::npos)
-        aggr = UMAX;
-
-      // put it into the Parameters structure
-      auto c_s_it = boost::find_if(parameters, [&generator](const auto &g) {
-        return g.value == generator;
-      });
-      if (c_s_it == parameters.end())
-        c_s_it = parameters.insert(c_s_it, CenterSphere{generator});
-
-      auto l_c_it = boost::find_if(c_s_it->next, [&level_count](const auto &l) {
-        return l.value == level_count;
-      });
-      if (l_c_it == c_s_it->next.end())
-        l_c_it = c_s_it->next.insert(l_c_it, LevelCount{level_count});
-
-      auto a_r_it = boost::find_if(l_c_it->next, [&area_ratio](const auto &a) {
-        return a.value == area_ratio;
-      });
-      if (a_r_it == l_c_it->next.end())
-        a_r_it = l_c_it->next.insert(a_r_it, AreaRatio{area_ratio});
-
-      auto aggr_it = boost::find(a_r_it->next, aggr);
-      if (aggr_it == a_r_it->next.end())
-        a_r_it->next.insert(aggr_it, aggr);
-    }
+    for (; !(table.at(row).empty() || table.at(row).at(0).empty()); ++row)
+      insert_signature(parameters, parse_signature(table.at(row)));
     row += 3; // skip header
     // files until the end
     for (; row < table.size(); ++row) {
@@ -139,9 +223,67 @@ void load_batch_file(const std::string &batch_file, Parameters &parameters,
   }
 }
 
+// column offset + 13 mesh properties + (empty column + 4 results) * parameter count
+static void fill_row(std::vector<std::string> &row,
+		     const std::size_t offset,
+		     const FileResults &data,
+		     const std::vector<std::size_t> &slots,
+		     const CodePool &codes) {
+  using boost::adaptors::indexed;
+  using namespace std::string_literals;
+
+  row.at(offset + 1) = to_string_coma(data.area);
+  row.at(offset + 2) = to_string_coma(data.volume);
+  row.at(offset + 3) = to_string_coma(data.a);
+  row.at(offset + 4) = to_string_coma(data.b);
+  row.at(offset + 5) = to_string_coma(data.c);
+  row.at(offset + 6) = to_string_coma(data.proj_circumference);
+  row.at(offset + 7) = to_string_coma(data.proj_area);
+  for (const auto &r : data.ratios | indexed()) {
+    row.at(offset + 8 + r.index()) = to_string_coma(r.value());
+  }
+  for (const auto &s : slots | indexed()) {
+    if (s.value() != SignatureTable::npos && data.surm.at(s.value()).computed) {
+      const auto &surm = data.surm[s.value()];
+      row.at(offset + 15 + 5 * s.index()) = std::to_string(surm.stable);
+      row.at(offset + 16 + 5 * s.index()) = std::to_string(surm.unstable);
+      row.at(offset + 17 + 5 * s.index()) = "R"s + codes[surm.reeb];
+      row.at(offset + 18 + 5 * s.index()) = "M"s + codes[surm.morse];
+    } else {
+      row.at(offset + 15 + 5 * s.index()) = "error"s;
+    }
+  }
+}
+
+static void fill_header(std::vector<std::string> &row,
+			const std::size_t offset,
+			const std::size_t signature_count) {
+  using boost::irange;
+  using namespace std::string_literals;
+
+  row.at(offset + 1) = "A"s;
+  row.at(offset + 2) = "V"s;
+  row.at(offset + 3) = "a"s;
+  row.at(offset + 4) = "b"s;
+  row.at(offset + 5) = "c"s;
+  row.at(offset + 6) = "K"s;
+  row.at(offset + 7) = "T"s;
+  row.at(offset + 8) = "c/a"s;
+  row.at(offset + 9) = "b/a"s;
+  row.at(offset + 10) = "Ibody"s;
+  row.at(offset + 11) = "Iproj"s;
+  row.at(offset + 12) = "Iellipsoid"s;
+  row.at(offset + 13) = "Iellipse"s;
+  for (const auto index : irange<std::size_t>(0, signature_count)) {
+    row.at(offset + 15 + 5 * index) = "S"s;
+    row.at(offset + 16 + 5 * index) = "U"s;
+    row.at(offset + 17 + 5 * index) = "Reeb"s;
+    row.at(offset + 18 + 5 * index) = "Morse"s;
+  }
+}
+
 void save_batch_file(const std::string &original_file,
                      const std::string &new_file, const Results &results) {
-  using boost::adaptors::indexed;
   using boost::irange;
   using namespace std::string_literals;
   auto table = parse_csv(original_file);
@@ -155,21 +297,10 @@ void save_batch_file(const std::string &original_file,
     row += 3; // skip empty row and header
     // parameters until empty row
     std::vector<ParameterSignature> signatures;
+    std::vector<std::size_t> slots;
     for (; !(table.at(row).empty() || table.at(row).at(0).empty()); ++row) {
-      Aggregation aggr = FIRST;
-      if (table.at(row).at(5).find("atlag") != std::string::npos)
-        aggr = AVERAGE;
-      else if (table.at(row).at(5).find("smin") != std::string::npos)
-        aggr = SMIN;
-      else if (table.at(row).at(5).find("smax") != std::string::npos)
-        aggr = SMAX;
-      else if (table.at(row).at(5).find("umin") != std::string::npos)
-        aggr = UMIN;
-      else if (table.at(row).at(5).find("umax") != std::string::npos)
-        aggr = UMAX;
-      signatures.emplace_back(
-          stod_coma(table.at(row).at(1)) / 100.0, std::stoi(table.at(row).at(2)),
-          std::stoi(table.at(row).at(3)), stod_coma(table.at(row).at(4)) / 100.0, aggr);
+      signatures.push_back(parse_signature(table.at(row)));
+      slots.push_back(results.signatures.find(signatures.back()));
     }
     // look for the first empty column in the header
     std::size_t column_count;
@@ -186,57 +317,21 @@ void save_batch_file(const std::string &original_file,
       table.at(row).at(column_count + 15 + 5 * index) = std::to_string(index + 1);
     row++;
     table.at(row).resize(width);
-    table.at(row).at(column_count + 1) = "A"s;
-    table.at(row).at(column_count + 2) = "V"s;
-    table.at(row).at(column_count + 3) = "a"s;
-    table.at(row).at(column_count + 4) = "b"s;
-    table.at(row).at(column_count + 5) = "c"s;
-    table.at(row).at(column_count + 6) = "K"s;
-    table.at(row).at(column_count + 7) = "T"s;
-    table.at(row).at(column_count + 8) = "c/a"s;
-    table.at(row).at(column_count + 9) = "b/a"s;
-    table.at(row).at(column_count + 10) = "Ibody"s;
-    table.at(row).at(column_count + 11) = "Iproj"s;
-    table.at(row).at(column_count + 12) = "Iellipsoid"s;
-    table.at(row).at(column_count + 13) = "Iellipse"s;    
-    for (const auto index : irange<typename std::vector<ParameterSignature>::size_type>(0, signatures.size())) {
-      table.at(row).at(column_count + 15 + 5 * index) = "S"s;
-      table.at(row).at(column_count + 16 + 5 * index) = "U"s;
-      table.at(row).at(column_count + 17 + 5 * index) = "Reeb"s;
-      table.at(row).at(column_count + 18 + 5 * index) = "Morse"s;
-    }
+    fill_header(table.at(row), column_count, signatures.size());
     row++;
     
     // files
+    std::unordered_map<std::string, std::size_t> indices;
+    for (const auto &file : results.files | boost::adaptors::indexed())
+      indices.emplace(file.value(), file.index());
     for (; row < table.size(); ++row) {
       table.at(row).resize(width);
-      const auto result = results.find(table.at(row).at(1));
-      if (result != results.end()) {
-	const auto &data = result->second;
-	table.at(row).at(column_count + 1) = to_string_coma(data.area);
-	table.at(row).at(column_count + 2) = to_string_coma(data.volume);
-	table.at(row).at(column_count + 3) = to_string_coma(data.a);
-	table.at(row).at(column_count + 4) = to_string_coma(data.b);
-	table.at(row).at(column_count + 5) = to_string_coma(data.c);
-	table.at(row).at(column_count + 6) = to_string_coma(data.proj_circumference);
-	table.at(row).at(column_count + 7) = to_string_coma(data.proj_area);
-	for (const auto &r : data.ratios | indexed()) {
-	  table.at(row).at(column_count + 8 + r.index()) = to_string_coma(r.value());
-	}
-	for (const auto &s : signatures | indexed()) {
-	  const auto surm = data.surm.find(s.value());
-	  if (surm != data.surm.end()) {
-	    table.at(row).at(column_count + 15 + 5 * s.index()) = std::to_string(surm->second.stable);
-	    table.at(row).at(column_count + 16 + 5 * s.index()) = std::to_string(surm->second.unstable);
-	    table.at(row).at(column_count + 17 + 5 * s.index()) = "R"s + surm->second.reeb;
-	    table.at(row).at(column_count + 18 + 5 * s.index()) = "M"s + surm->second.morse;
-	  } else {
-	    table.at(row).at(column_count + 15 + 5 * s.index()) = "error"s;
-	  }
-	}
-      } else {
+      const auto index = indices.find(table.at(row).at(1));
+      if (index != indices.end())
+	fill_row(table.at(row), column_count, results.data[index->second], slots,
+		 *results.codes);
+      else
 	table.at(row).at(column_count + 1) = "error"s;
-      }
     }
   } catch (const std::out_of_range &oor) {
     std::cerr << oor.what() << '\n';
@@ -246,3 +341,38 @@ void save_batch_file(const std::string &original_file,
 
   write_csv(new_file, table);
 }
+
+void save_results(const std::string &new_file,
+		  const std::vector<ParameterSignature> &signatures,
+		  const Results &results) {
+  using boost::adaptors::indexed;
+  using namespace std::string_literals;
+
+  // file name + 13 mesh properties + (empty column + 4 results) * parameter count
+  const auto width = 14 + 5 * signatures.size();
+  const auto &files = results.files;
+  std::vector<std::vector<std::string>> table(files.size() + 2,
+					      std::vector<std::string>(width));
+
+  // the parameters of each result group in the same units as the batch file
+  table.at(0).at(0) = "Parameters"s;
+  std::vector<std::size_t> slots;
+  for (const auto &s : signatures | indexed()) {
+    slots.push_back(results.signatures.find(s.value()));
+    const auto &[ratio, count, level_count, area_ratio, aggr] = s.value();
+    table.at(0).at(15 + 5 * s.index()) =
+      to_string_coma(ratio * 100.0) + " "s + std::to_string(count) + " "s +
+      std::to_string(level_count) + " "s +
+      to_string_coma(area_ratio * 100.0) + " "s + aggregation_names[aggr];
+  }
+  table.at(1).at(0) = "File"s;
+  fill_header(table.at(1), 0, signatures.size());
+
+  for (const auto &file : files | indexed()) {
+    auto &row = table.at(file.index() + 2);
+    row.at(0) = file.value();
+    fill_row(row, 0, results.data[file.index()], slots, *results.codes);
+  }
+
+  write_csv(new_file, table);
+}
@@ -20,32 +20,106 @@
 #ifndef MODEL_BATCH_HPP
 #define MODEL_BATCH_HPP 1
 
+#include <boost/container/flat_map.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/range/algorithm/find.hpp>
 #include <boost/range/algorithm/find_if.hpp>
 #include <boost/tokenizer.hpp>
 #include <codecvt>
+#include <cstdint>
+#include <deque>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "parameters.hpp"
 
+enum Status {
+  STATUS_WAITING,
+  STATUS_RUNNING,
+  STATUS_OK,
+  STATUS_ERROR,
+  STATUS_CANCELLED
+};
+
 using ParameterSignature = std::tuple<double, int, int, double, Aggregation>;
+
+// The signatures of a batch, each interned into a fixed slot of FileResults.
+class SignatureTable {
+  std::vector<ParameterSignature> m_signatures;
+  boost::container::flat_map<ParameterSignature, std::size_t> m_slots;
+public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  SignatureTable() = default;
+  // duplicates share the slot of their first occurrence
+  explicit SignatureTable(const std::vector<ParameterSignature> &signatures);
+  std::size_t find(const ParameterSignature &signature) const;
+  // the slots of the signatures of parameters, which must all be known
+  std::vector<std::size_t> slots(const Parameters &parameters) const;
+  const std::vector<ParameterSignature> &signatures() const {
+    return m_signatures;
+  }
+  std::size_t size() const {
+    return m_signatures.size();
+  }
+};
+
+// The reeb and morse codes of a batch, each stored once, since few distinct
+// ones repeat across the files. Append only, so ids and references stay valid.
+class CodePool {
+  mutable std::shared_mutex m_mutex;
+  // a deque never moves its elements, so the keys can view into them
+  std::deque<std::string> m_codes;
+  std::unordered_map<std::string_view, std::uint32_t> m_ids;
+public:
+  using Id = std::uint32_t;
+
+  // id 0 is the empty code
+  CodePool();
+  CodePool(const CodePool &) = delete;
+  CodePool &operator=(const CodePool &) = delete;
+
+  Id intern(const std::string &code);
+  const std::string &operator[](Id id) const;
+};
+
 struct SURM {
+  bool computed = false;
   float stable;
   float unstable;
-  std::string reeb;
-  std::string morse;
+  CodePool::Id reeb = 0;
+  CodePool::Id morse = 0;
 };
 struct FileResults {
   double area, volume;
   double a, b, c;
   double proj_circumference, proj_area;
   std::array<double, 6> ratios;
-  std::map<ParameterSignature, SURM> surm;
+  // indexed by the slots of the SignatureTable
+  std::vector<SURM> surm;
 };
-using Results = std::unordered_map<std::string, FileResults>;
+// One row of slots per file, allocated up front so that the workers only
+// write their own elements.
+struct Results {
+  SignatureTable signatures;
+  std::vector<std::string> files;
+  std::vector<FileResults> data;
+  std::unique_ptr<CodePool> codes = std::make_unique<CodePool>();
+
+  Results() = default;
+  Results(SignatureTable signatures, std::vector<std::string> files);
+};
+
+std::vector<ParameterSignature> parameter_signatures(const Parameters &parameters);
+Aggregation parse_aggregation(const std::string &name);
+void insert_signature(Parameters &parameters,
+		      const ParameterSignature &signature);
 
 void load_batch_file(const std::string &batch_file,
 		     Parameters &parameters,
@@ -53,5 +127,9 @@ void load_batch_file(const std::string &batch_file,
 void save_batch_file(const std::string &original_file,
 		     const std::string &new_file,
 		     const Results &results);
+// one column group per signature, in the given order
+void save_results(const std::string &new_file,
+		  const std::vector<ParameterSignature> &signatures,
+		  const Results &results);
 
 #endif // MODEL_BATCH_HPP
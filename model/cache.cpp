@@ -0,0 +1,237 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cache.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/range/algorithm/find.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+ContentHash content_hash(const char *begin, const char *end) {
+  // 64 bit FNV-1a
+  ContentHash hash = 0xcbf29ce484222325ull;
+  for (; begin != end; ++begin) {
+    hash ^= static_cast<unsigned char>(*begin);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+void write_record(std::ostream &output,
+		  const FileResults &results,
+		  const SignatureTable &signatures,
+		  const CodePool &codes,
+		  const std::vector<std::size_t> &slots) {
+  output << std::setprecision(std::numeric_limits<double>::max_digits10);
+  output << "P " << results.area << ' ' << results.volume << ' '
+	 << results.a << ' ' << results.b << ' ' << results.c << ' '
+	 << results.proj_circumference << ' ' << results.proj_area;
+  for (const auto ratio : results.ratios)
+    output << ' ' << ratio;
+  output << '\n';
+  for (const auto slot : slots) {
+    const auto &surm = results.surm.at(slot);
+    if (!surm.computed)
+      continue;
+    const auto &[ratio, count, level_count, area_ratio, aggr] =
+      signatures.signatures()[slot];
+    output << "S " << ratio << ' ' << count << ' ' << level_count << ' '
+	   << area_ratio << ' ' << static_cast<int>(aggr) << ' '
+	   << surm.stable << ' ' << surm.unstable << ' '
+	   << std::quoted(codes[surm.reeb]) << ' '
+	   << std::quoted(codes[surm.morse]) << '\n';
+  }
+  output << "E\n";
+}
+
+// operator>> fails on the nan and inf that operator<< writes
+template <typename... Numbers>
+static std::istream &read_numbers(std::istream &input, Numbers &... numbers) {
+  auto read = [&input](auto &number) {
+    std::string token;
+    if (input >> token) {
+      char *end;
+      number = static_cast<std::decay_t<decltype(number)>>(
+	  std::strtod(token.c_str(), &end));
+      if (*end != '\0')
+	input.setstate(std::ios::failbit);
+    }
+  };
+  (read(numbers), ...);
+  return input;
+}
+
+bool read_record(std::istream &input,
+		 FileResults &results,
+		 const SignatureTable &signatures,
+		 CodePool &codes) {
+  FileResults record;
+  record.surm.resize(signatures.size());
+  bool has_properties = false;
+  std::string line;
+  while (std::getline(input, line)) {
+    std::istringstream stream(line);
+    char type = 0;
+    stream >> type;
+    switch (type) {
+    case 'P':
+      read_numbers(stream, record.area, record.volume, record.a, record.b,
+		   record.c, record.proj_circumference, record.proj_area);
+      for (auto &ratio : record.ratios)
+	read_numbers(stream, ratio);
+      has_properties = true;
+      break;
+    case 'S': {
+      double ratio, area_ratio;
+      int count, level_count, aggr;
+      SURM surm;
+      std::string reeb, morse;
+      read_numbers(stream, ratio, count, level_count, area_ratio, aggr,
+		   surm.stable, surm.unstable);
+      stream >> std::quoted(reeb) >> std::quoted(morse);
+      surm.computed = true;
+      const auto slot = signatures.find(ParameterSignature(ratio, count, level_count, area_ratio,
+							   static_cast<Aggregation>(aggr)));
+      if (slot != SignatureTable::npos) {
+	surm.reeb = codes.intern(reeb);
+	surm.morse = codes.intern(morse);
+	record.surm[slot] = surm;
+      }
+      break;
+    }
+    case 'E':
+      if (!has_properties)
+	return false;
+      // the newer record wins
+      results.surm.resize(signatures.size());
+      for (std::size_t slot = 0; slot < record.surm.size(); ++slot)
+	if (record.surm[slot].computed)
+	  results.surm[slot] = record.surm[slot];
+      record.surm = std::move(results.surm);
+      results = std::move(record);
+      return true;
+    default:
+      return false;
+    }
+    if (!stream)
+      return false;
+  }
+  return false;
+}
+
+Parameters missing_parameters(const Parameters &parameters,
+			      const FileResults &results,
+			      const SignatureTable &signatures) {
+  Parameters missing;
+  for (const auto &signature : parameter_signatures(parameters)) {
+    const auto slot = signatures.find(signature);
+    if (slot == SignatureTable::npos || !results.surm.at(slot).computed)
+      insert_signature(missing, signature);
+  }
+  return missing;
+}
+
+ResultCache::ResultCache(boost::filesystem::path directory) :
+  m_directory(std::move(directory)) {
+  boost::system::error_code error;
+  boost::filesystem::create_directories(m_directory, error);
+}
+
+boost::filesystem::path ResultCache::file(ContentHash hash,
+					  const char *extension) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.%s",
+		static_cast<unsigned long long>(hash), extension);
+  return m_directory / name;
+}
+
+// Every record starts with a P line. A record that was cut off by a crash,
+// or that the next one was appended to, is skipped up to the next P line.
+bool ResultCache::load(ContentHash hash,
+		       FileResults &results,
+		       const SignatureTable &signatures,
+		       CodePool &codes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::ifstream input(file(hash, "results").string());
+  std::string line, record;
+  bool found = false, in_record = false;
+  while (std::getline(input, line)) {
+    if (line.empty())
+      continue;
+    if (line[0] == 'P') {
+      record.clear();
+      in_record = true;
+    }
+    if (!in_record)
+      continue;
+    record += line;
+    record += '\n';
+    if (line[0] != 'E')
+      continue;
+    in_record = false;
+    std::istringstream stream(record);
+    if (read_record(stream, results, signatures, codes))
+      found = true;
+  }
+  return found;
+}
+
+// whether a record appended to path starts on a line of its own
+static bool ends_with_newline(const boost::filesystem::path &path) {
+  std::ifstream input(path.string(), std::ios::binary | std::ios::ate);
+  if (!input || input.tellg() <= 0)
+    return true;
+  input.seekg(-1, std::ios::end);
+  return input.get() == '\n';
+}
+
+void ResultCache::store(ContentHash hash,
+			const FileResults &results,
+			const SignatureTable &signatures,
+			const CodePool &codes,
+			const std::vector<std::size_t> &slots) {
+  const auto path = file(hash, "results");
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::ostringstream record;
+  if (!ends_with_newline(path))
+    record << '\n';
+  write_record(record, results, signatures, codes, slots);
+  // unbuffered, so that the record goes out in a single write and doesn't
+  // interleave with the records of other processes
+  std::ofstream output;
+  output.rdbuf()->pubsetbuf(nullptr, 0);
+  output.open(path.string(), std::ios::app | std::ios::binary);
+  const auto text = record.str();
+  output.write(text.data(), text.size());
+}
+
+bool ResultCache::load_prepared(ContentHash hash, PreparedMesh &prepared) const {
+  // the files are renamed into place, so no lock is needed
+  return read_prepared_mesh(file(hash, "mesh"), prepared);
+}
+
+void ResultCache::store_prepared(ContentHash hash,
+				 const PreparedMesh &prepared) const {
+  write_prepared_mesh(file(hash, "mesh"), prepared);
+}
@@ -0,0 +1,80 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_CACHE_HPP
+#define MODEL_CACHE_HPP 1
+
+#include <boost/filesystem/path.hpp>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+
+#include "batch.hpp"
+#include "prepared_mesh.hpp"
+
+using ContentHash = std::uint64_t;
+
+ContentHash content_hash(const char *begin, const char *end);
+
+// A record holds the mesh properties and the computed slots of a file among
+// the listed ones. It is terminated by a line of its own so that a half
+// written record at the end of a file can be recognized and ignored.
+void write_record(std::ostream &output,
+		  const FileResults &results,
+		  const SignatureTable &signatures,
+		  const CodePool &codes,
+		  const std::vector<std::size_t> &slots);
+// Returns false at the end of the input or at an incomplete record. Results
+// of signatures that are not in the table are skipped.
+bool read_record(std::istream &input,
+		 FileResults &results,
+		 const SignatureTable &signatures,
+		 CodePool &codes);
+
+// the subtree of parameters that has no results yet
+Parameters missing_parameters(const Parameters &parameters,
+			      const FileResults &results,
+			      const SignatureTable &signatures);
+
+// Results of earlier runs, one append only file per mesh content, and the
+// prepared meshes themselves.
+class ResultCache {
+  const boost::filesystem::path m_directory;
+  std::mutex m_mutex;
+
+  boost::filesystem::path file(ContentHash hash, const char *extension) const;
+public:
+  explicit ResultCache(boost::filesystem::path directory);
+  // returns false if the mesh properties are not known yet
+  bool load(ContentHash hash,
+	    FileResults &results,
+	    const SignatureTable &signatures,
+	    CodePool &codes);
+  void store(ContentHash hash,
+	     const FileResults &results,
+	     const SignatureTable &signatures,
+	     const CodePool &codes,
+	     const std::vector<std::size_t> &slots);
+  // returns false if the mesh has not been prepared yet
+  bool load_prepared(ContentHash hash, PreparedMesh &prepared) const;
+  void store_prepared(ContentHash hash, const PreparedMesh &prepared) const;
+};
+
+#endif // MODEL_CACHE_HPP
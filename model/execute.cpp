@@ -19,23 +19,30 @@
 
 #include "primitives.hpp"
 #include "execute.hpp"
+#include "hull_filter.hpp"
 #include <CGAL/bounding_box.h>
+#include <stdexcept>
 
-void load_mesh(const std::string &filename,
-	       Mesh &mesh,
-	       const boost::filesystem::path &directory) {
-  const boost::iostreams::mapped_file_source file((directory / filename).string());
-  contours::read_STL(file.begin(), file.end(), mesh, mesh.points());
+MeshReadStatistics load_mesh(const char *begin, const char *end, Mesh &mesh) {
+  std::vector<Point> points;
+  const auto statistics = read_points(begin, end, points);
+  if (points.empty())
+    throw std::runtime_error("no points in mesh");
 
-  const auto origin = CGAL::centroid(mesh.points().begin(), mesh.points().end());
-  std::transform(mesh.points().begin(),
-		 mesh.points().end(),
-		 mesh.points().begin(),
+  // the centroid of the raw points, as it has always been
+  const auto origin = CGAL::centroid(points.begin(), points.end());
+  // most points of a scan are shared by several facets or are far inside
+  collapse_duplicates(points);
+  discard_interior_points(points);
+  std::transform(points.begin(),
+		 points.end(),
+		 points.begin(),
 		 Transform(CGAL::TRANSLATION,
 			   Vector(origin, Point(CGAL::ORIGIN))));
   
-  CGAL::convex_hull_3(mesh.points().begin(), mesh.points().end(), mesh);
+  CGAL::convex_hull_3(points.begin(), points.end(), mesh);
   mesh.collect_garbage();
+  return statistics;
 }
 
 std::array<double, 13> mesh_properties(const Mesh &mesh) {
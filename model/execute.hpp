@@ -28,7 +28,6 @@
 #include <contours/intersect_faces.hpp>
 #include <contours/intersect_halfedges.hpp>
 #include <contours/mesh_properties.hpp>
-#include <contours/stl_io.hpp>
 #include <contours/util.hpp>
 #include <contours/merge_equal_vertices.hpp>
 #include <contours/discover_graph.hpp>
@@ -36,28 +35,43 @@
 #include <contours/make_reeb.hpp>
 #include <contours/encode_graph.hpp>
 #include <contours/axes.hpp>
+#include <atomic>
+#include <dependencies.hpp>
 #include <string>
 #include <vector>
+#ifdef TBB_FOUND
+#include <tbb/parallel_for.h>
+#endif //TBB_FOUND
 
+#include "mesh_io.hpp"
 #include "parameters.hpp"
+#include "reeb.hpp"
+#include "saver_traits.hpp"
+#include "workspace.hpp"
 
-void load_mesh(const std::string &filename,
-	       Mesh &mesh,
-	       const boost::filesystem::path &directory = boost::filesystem::path());
+// reads the convex hull of a mesh, centered on the centroid of its points
+MeshReadStatistics load_mesh(const char *begin, const char *end, Mesh &mesh);
 
 std::array<double, 13> mesh_properties(const Mesh &mesh);
 
+// returns the bytes the workspaces of the computation have taken at most
 template <typename Saver>
-void execute(const std::string &filename,
-	     const Mesh &mesh,
-	     const double area,
-	     const double volume,
-	     const Parameters &center_spheres,
-	     Saver &saver) {
+std::size_t execute(const std::string &filename,
+		    const Mesh &mesh,
+		    const double area,
+		    const double volume,
+		    const Parameters &center_spheres,
+		    Saver &saver,
+		    const std::atomic_bool &cancelled) {
   using namespace std;
   using namespace boost;
   using namespace boost::adaptors;
 
+  // reused by all centers and level counts
+  Pool<Workspace> workspaces;
+  // only used by the first center, which runs on one thread at a time
+  EncodingCache encodings;
+
   for (const auto &center_sphere : center_spheres | indexed()) {
     const auto centers = center_sphere.value().value(volume);
 
@@ -69,19 +83,59 @@ void execute(const std::string &filename,
       }
     }
 
-    for (const auto &center : centers | indexed()) {
-      const auto min_distance =
-	contours::min_distance(mesh, mesh.points(), center.value());
-      const auto max_distance =
-	contours::max_distance(mesh, mesh.points(), center.value()) + 0.0001;
+    // level counts nested into a finer one reuse its halfedge intersections,
+    // so they run right after it and a single table is kept at a time
+    const auto sources = finest_nesting(center_sphere.value().next);
+    const auto order = nesting_order(sources);
+
+    // every center writes its own slots of results, and only the first one
+    // calls the saver, so the centers can be processed in parallel
+#ifdef TBB_FOUND
+    tbb::task_group_context context;
+#endif //TBB_FOUND
+    auto process_center = [&](const std::size_t center_index) {
+      if (cancelled) {
+#ifdef TBB_FOUND
+	context.cancel_group_execution();
+#endif //TBB_FOUND
+	return;
+      }
+      const auto &center = centers[center_index];
+      const auto workspace = workspaces.acquire();
+      // shared by all level counts of the center
+      distance_field(mesh, center, workspace->distances);
+      const auto [closest, farthest] =
+	std::minmax_element(workspace->distances.begin(), workspace->distances.end());
+      const auto min_distance = *closest;
+      const auto max_distance = *farthest + 0.0001;
+      // the level count whose intersections the table holds
+      auto intersected = std::numeric_limits<std::size_t>::max();
 
-      for (const auto &level_count : center_sphere.value().next | indexed()) {
+      for (const auto level_count_index : order) {
+	if (cancelled)
+	  return;
+	const auto &level_count = center_sphere.value().next[level_count_index];
         const auto step =
-	  (max_distance - min_distance) / (level_count.value().value + 1);
-	std::vector<std::map<int, std::pair<Point, Point>>> h_i(mesh.num_halfedges());
-	auto halfedge_intersections = boost::make_iterator_property_map(h_i.begin(), CGAL::get(boost::halfedge_index, mesh));
-        contours::intersect_halfedges(mesh, mesh.points(), center.value(), min_distance,
-                                   step, halfedge_intersections);
+	  (max_distance - min_distance) / (level_count.value + 1);
+	const auto source = sources[level_count_index];
+	const auto source_count = center_sphere.value().next[source].value;
+	auto &finest = workspace->finest_intersections;
+	if (intersected != source) {
+	  const auto source_step = (max_distance - min_distance) / (source_count + 1);
+	  finest.reset(mesh);
+	  finest.reserve(mesh, workspace->distances, min_distance, source_step);
+	  contours::intersect_halfedges(mesh, mesh.points(), center, min_distance,
+					source_step, finest.map(mesh));
+	  intersected = source;
+	}
+	auto *intersections = &finest;
+	if (source != level_count_index) {
+	  workspace->derived_intersections.derive(finest, (source_count + 1) / (level_count.value + 1));
+	  intersections = &workspace->derived_intersections;
+	}
+	auto halfedge_intersections = intersections->map(mesh);
+	// declared before the graph, so it is freed with the arena
+	ArenaScope arena_scope(workspace->arena);
         Graph graph;
         auto area_map = boost::get(&VertexProperty::area, graph);
         auto eq_map = boost::get(&VertexProperty::eq_edges, graph);
@@ -94,58 +148,94 @@ void execute(const std::string &filename,
 	auto roots_outside_map = boost::get(&EdgeProperty::roots_outside, reverse);
 	auto vertex_level = boost::get(&VertexProperty::level, graph);
 	auto vertex_label = boost::get(&VertexProperty::label, graph);
-	auto arc_list = boost::get(&EdgeProperty::arcs, graph);
+	// the arcs are only drawn from the level graphs
+	auto arc_list = [&graph] {
+	  if constexpr (wants_level_graphs<Saver>::value)
+	    return boost::get(&EdgeProperty::arcs, graph);
+	  else
+	    return NullArcMap();
+	}();
 	auto vertex_id = boost::get(&VertexProperty::id, graph);
 	std::vector<GraphVertex> stable_vertices, unstable_vertices;
 
-	std::vector<std::map<int, GraphVertex>> f_h(mesh.num_halfedges()), t_h(mesh.num_halfedges());
-	auto to_halfedge = boost::make_iterator_property_map(t_h.begin(), CGAL::get(boost::halfedge_index, mesh));
-	auto from_halfedge = boost::make_iterator_property_map(f_h.begin(), CGAL::get(boost::halfedge_index, mesh));
+	workspace->to_halfedge.reset(mesh);
+	workspace->from_halfedge.reset(mesh);
+	auto to_halfedge = workspace->to_halfedge.map(mesh);
+	auto from_halfedge = workspace->from_halfedge.map(mesh);
 	contours::intersect_faces(mesh, mesh.points(), halfedge_intersections,
-                               to_halfedge, from_halfedge, center.value(), min_distance,
+                               to_halfedge, from_halfedge, center, min_distance,
                                step, graph, area_map, eq_map, edge_level, arc_list);
         contours::merge_equal_vertices(graph, eq_map, area_map, visited_map, arc_list);
         contours::discover_graph(graph, area_map, area_inside_map, roots_inside_map, back_inserter(stable_vertices));
 	contours::discover_graph(reverse, area_map, area_outside_map, roots_outside_map, back_inserter(unstable_vertices));
-        for (const auto &area_ratio : level_count.value().next | indexed()) {
+        for (const auto &area_ratio : level_count.next | indexed()) {
           vector<GraphEdge> stable_edges;
 	  vector<ReverseEdge> unstable_edges;
           contours::find_equilibria(graph, stable_vertices, area_inside_map, roots_inside_map, back_inserter(stable_edges), area * area_ratio.value().value);
           contours::find_equilibria(reverse, unstable_vertices, area_outside_map, roots_outside_map, back_inserter(unstable_edges), area * area_ratio.value().value);
 	  
-	  vector<GraphEdge> underlying_unstable;
-	  for (const auto &u : unstable_edges)
-	    underlying_unstable.push_back(get(edge_underlying, reverse, u));
-	  
-	  saver.level_graph(filename, center_sphere.value().value, level_count.value().value, graph, stable_edges, underlying_unstable);
-          results[level_count.index()][area_ratio.index()][center.index()] =
+	  if constexpr (wants_level_graphs<Saver>::value) {
+	    if (center_index == 0) {
+	      vector<GraphEdge> underlying_unstable;
+	      for (const auto &u : unstable_edges)
+		underlying_unstable.push_back(get(edge_underlying, reverse, u));
+	      saver.level_graph(filename, center_sphere.value().value, level_count.value, graph, stable_edges, underlying_unstable);
+	    }
+	  }
+          results[level_count_index][area_ratio.index()][center_index] =
               make_pair(stable_edges.size(), unstable_edges.size());
 
 	  // this part only makes sense when dealing with a single graph
-	  if (boost::find(area_ratio.value().next, FIRST) != area_ratio.value().next.end() && center.index() == 0) {
+	  if (!(wants_reeb<Saver>::value || wants_morse<Saver>::value))
+	    continue;
+	  if (boost::find(area_ratio.value().next, FIRST) != area_ratio.value().next.end() && center_index == 0) {
 	    for (const auto &vertex : boost::make_iterator_range(boost::vertices(graph)))
 	      graph[vertex].visited = false;
 	    contours::mark_inside(graph, stable_vertices, stable_edges, visited_map);
 	    contours::mark_inside(reverse, unstable_vertices, unstable_edges, visited_map);
 
-	    // make a copy
-	    Graph reeb(graph);
-	    auto reeb_visited_map = boost::get(&VertexProperty::visited, reeb);
-	    auto reeb_edge_level = boost::get(&EdgeProperty::level, reeb);
-	    auto reeb_vertex_level = boost::get(&VertexProperty::level, reeb);
-	    contours::make_reeb(reeb, reeb_visited_map, reeb_edge_level, reeb_vertex_level);
-	    for (const auto &vertex : boost::make_iterator_range(boost::vertices(reeb)) | indexed())
-	      reeb[vertex.value()].id = vertex.index();
-	    auto reeb_vertex_id = boost::get(&VertexProperty::id, reeb);
-	    auto reeb_vertex_label = boost::get(&VertexProperty::label, reeb);
-	    contours::reeb_encode(reeb, reeb_vertex_id, reeb_vertex_label);
-	    saver.reeb(filename, center_sphere.value().value, level_count.value().value, area_ratio.value().value, FIRST, reeb, contours::encode(reeb, reeb_vertex_label));
-	    if (contours::make_morse(reeb, reeb_vertex_level, reeb_vertex_label))
-	      saver.morse(filename, center_sphere.value().value, level_count.value().value, area_ratio.value().value, FIRST, contours::encode(reeb, reeb_vertex_label));
+	    // sweeps often mark the same edges for many area ratios
+	    auto key = topology_key(graph);
+	    auto codes = encodings.find(key);
+	    const bool known = codes != encodings.end();
+	    // only the topology is needed, not the areas and arcs
+	    ReebGraph reeb;
+	    auto reeb_vertex_level = boost::get(&ReebVertexProperty::level, reeb);
+	    auto reeb_vertex_label = boost::get(&ReebVertexProperty::label, reeb);
+	    if (!known || wants_reeb_graph<Saver>::value) {
+	      copy_topology(graph, reeb);
+	      auto reeb_visited_map = boost::get(&ReebVertexProperty::visited, reeb);
+	      auto reeb_edge_level = boost::get(&ReebEdgeProperty::level, reeb);
+	      contours::make_reeb(reeb, reeb_visited_map, reeb_edge_level, reeb_vertex_level);
+	      for (const auto &vertex : boost::make_iterator_range(boost::vertices(reeb)) | indexed())
+		reeb[vertex.value()].id = vertex.index();
+	    }
+	    if (!known) {
+	      auto reeb_vertex_id = boost::get(&ReebVertexProperty::id, reeb);
+	      contours::reeb_encode(reeb, reeb_vertex_id, reeb_vertex_label);
+	      codes = encodings.emplace(std::move(key), ReebCodes{contours::encode(reeb, reeb_vertex_label), {}}).first;
+	    }
+	    if constexpr (wants_reeb<Saver>::value)
+	      saver.reeb(filename, center_sphere.value().value, level_count.value, area_ratio.value().value, FIRST, reeb, codes->second.reeb);
+	    if constexpr (wants_morse<Saver>::value) {
+	      if (!known && contours::make_morse(reeb, reeb_vertex_level, reeb_vertex_label))
+		codes->second.morse = contours::encode(reeb, reeb_vertex_label);
+	      if (codes->second.morse)
+		saver.morse(filename, center_sphere.value().value, level_count.value, area_ratio.value().value, FIRST, *codes->second.morse);
+	    }
 	  }
         }
       }
-    }
+    };
+#ifdef TBB_FOUND
+    tbb::parallel_for(std::size_t(0), centers.size(), process_center, context);
+#else
+    for (std::size_t center_index = 0; center_index < centers.size(); ++center_index)
+      process_center(center_index);
+#endif //TBB_FOUND
+    // the results are incomplete, don't aggregate them
+    if (cancelled)
+      return workspaces.memory_size();
 
     for (const auto &level_count : center_sphere.value().next | indexed()) {
       for (const auto &area_ratio : level_count.value().next | indexed()) {
@@ -188,6 +278,7 @@ void execute(const std::string &filename,
       }
     }
   }
+  return workspaces.memory_size();
 }
 
-#endif // MODEL_EXECUTE_HPP
+#endif // MODEL_EXECUTE_HPP
\ No newline at end of file
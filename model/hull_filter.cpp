@@ -0,0 +1,192 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "hull_filter.hpp"
+
+#include <dependencies.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#ifdef TBB_FOUND
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#endif //TBB_FOUND
+
+static std::size_t hash_point(const Point &point) {
+  // +0.0 adds nothing so that -0.0 hashes the same
+  const std::hash<double> hash;
+  std::size_t seed = 0;
+  for (const auto coordinate : {point.x() + 0.0, point.y() + 0.0, point.z() + 0.0})
+    seed ^= hash(coordinate) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+void collapse_duplicates(std::vector<Point> &points) {
+  // open addressing over the indices of the points kept so far
+  constexpr auto empty = std::numeric_limits<std::size_t>::max();
+  std::size_t capacity = 16;
+  while (capacity < 2 * points.size())
+    capacity *= 2;
+  const auto mask = capacity - 1;
+  std::vector<std::size_t> table(capacity, empty);
+
+  std::size_t kept = 0;
+  for (std::size_t index = 0; index < points.size(); ++index) {
+    auto slot = hash_point(points[index]) & mask;
+    while (table[slot] != empty && !(points[table[slot]] == points[index]))
+      slot = (slot + 1) & mask;
+    if (table[slot] != empty)
+      continue;
+    table[slot] = kept;
+    points[kept++] = points[index];
+  }
+  points.resize(kept);
+}
+
+// the axes, the face diagonals and the space diagonals of the cube
+static const std::array<Vector, 13> directions = {
+  Vector(1, 0, 0), Vector(0, 1, 0), Vector(0, 0, 1),
+  Vector(1, 1, 0), Vector(1, -1, 0), Vector(1, 0, 1),
+  Vector(1, 0, -1), Vector(0, 1, 1), Vector(0, 1, -1),
+  Vector(1, 1, 1), Vector(1, 1, -1), Vector(1, -1, 1), Vector(-1, 1, 1)
+};
+
+// indices of the points with the smallest and the largest projection onto
+// every direction
+using Extremes = std::array<std::size_t, 2 * directions.size()>;
+
+static Extremes find_extremes(const std::vector<Point> &points,
+			      const std::size_t begin,
+			      const std::size_t end) {
+  Extremes extremes;
+  extremes.fill(begin);
+  for (auto index = begin; index < end; ++index)
+    for (std::size_t d = 0; d < directions.size(); ++d) {
+      const auto projection = (points[index] - CGAL::ORIGIN) * directions[d];
+      if (projection < (points[extremes[2 * d]] - CGAL::ORIGIN) * directions[d])
+	extremes[2 * d] = index;
+      if (projection > (points[extremes[2 * d + 1]] - CGAL::ORIGIN) * directions[d])
+	extremes[2 * d + 1] = index;
+    }
+  return extremes;
+}
+
+static Extremes merge_extremes(const std::vector<Point> &points,
+			       Extremes first,
+			       const Extremes &second) {
+  for (std::size_t d = 0; d < directions.size(); ++d) {
+    if ((points[second[2 * d]] - CGAL::ORIGIN) * directions[d] <
+	(points[first[2 * d]] - CGAL::ORIGIN) * directions[d])
+      first[2 * d] = second[2 * d];
+    if ((points[second[2 * d + 1]] - CGAL::ORIGIN) * directions[d] >
+	(points[first[2 * d + 1]] - CGAL::ORIGIN) * directions[d])
+      first[2 * d + 1] = second[2 * d + 1];
+  }
+  return first;
+}
+
+struct Plane {
+  Vector normal;
+  double offset;
+};
+
+void discard_interior_points(std::vector<Point> &points) {
+  if (points.size() < 4 * directions.size())
+    return;
+
+#ifdef TBB_FOUND
+  const auto extremes = tbb::parallel_reduce(
+      tbb::blocked_range<std::size_t>(0, points.size()),
+      find_extremes(points, 0, 1),
+      [&points](const tbb::blocked_range<std::size_t> &range, const Extremes &extremes) {
+	return merge_extremes(points, extremes,
+			      find_extremes(points, range.begin(), range.end()));
+      },
+      [&points](const Extremes &first, const Extremes &second) {
+	return merge_extremes(points, first, second);
+      });
+#else
+  const auto extremes = find_extremes(points, 0, points.size());
+#endif //TBB_FOUND
+  std::vector<Point> corners;
+  for (const auto index : extremes)
+    corners.push_back(points[index]);
+  collapse_duplicates(corners);
+
+  // a margin relative to the size of the mesh keeps the points near the
+  // faces of the polytope, in case rounding puts them inside
+  double scale = 1.0;
+  for (const auto &corner : corners)
+    scale = std::max({scale, std::abs(corner.x()), std::abs(corner.y()), std::abs(corner.z())});
+  const auto margin = 1e-9 * scale;
+
+  // The polytope has few enough corners to try every triangle of them. The
+  // planes with every corner on one side are its faces. Coplanar corners
+  // give both orientations of the same plane, and nothing is discarded.
+  std::vector<Plane> planes;
+  for (std::size_t i = 0; i < corners.size(); ++i)
+    for (std::size_t j = i + 1; j < corners.size(); ++j)
+      for (std::size_t k = j + 1; k < corners.size(); ++k) {
+	auto normal = CGAL::cross_product(corners[j] - corners[i], corners[k] - corners[i]);
+	const auto length = std::sqrt(normal.squared_length());
+	if (length == 0.0)
+	  continue;
+	normal = normal / length;
+	const auto offset = (corners[i] - CGAL::ORIGIN) * normal;
+	bool below = true, above = true;
+	for (const auto &corner : corners) {
+	  const auto distance = (corner - CGAL::ORIGIN) * normal - offset;
+	  below = below && distance <= margin;
+	  above = above && distance >= -margin;
+	}
+	if (below)
+	  planes.push_back({normal, offset});
+	if (above)
+	  planes.push_back({-normal, -offset});
+      }
+  // degenerate corners span no polytope, and no point is known to be inside
+  if (planes.empty())
+    return;
+
+  std::vector<char> interior(points.size());
+  auto classify = [&](const std::size_t begin, const std::size_t end) {
+    for (auto index = begin; index < end; ++index)
+      interior[index] = std::all_of(planes.begin(), planes.end(), [&](const Plane &plane) {
+	  return (points[index] - CGAL::ORIGIN) * plane.normal < plane.offset - margin;
+	});
+  };
+#ifdef TBB_FOUND
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, points.size()),
+		    [&classify](const tbb::blocked_range<std::size_t> &range) {
+		      classify(range.begin(), range.end());
+		    });
+#else
+  classify(0, points.size());
+#endif //TBB_FOUND
+
+  std::size_t kept = 0;
+  for (std::size_t index = 0; index < points.size(); ++index)
+    if (!interior[index])
+      points[kept++] = points[index];
+  points.resize(kept);
+}
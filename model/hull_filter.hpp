@@ -0,0 +1,35 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_HULL_FILTER_HPP
+#define MODEL_HULL_FILTER_HPP 1
+
+#include <vector>
+
+#include "primitives.hpp"
+
+// Removes the points equal to an earlier one, keeping the order of the rest.
+void collapse_duplicates(std::vector<Point> &points);
+
+// Akl-Toussaint heuristic: removes the points strictly inside the polytope
+// of the extreme points along a few fixed directions. None of them can be a
+// vertex of the convex hull, so the hull of the rest is the same.
+void discard_interior_points(std::vector<Point> &points);
+
+#endif // MODEL_HULL_FILTER_HPP
@@ -0,0 +1,150 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "journal.hpp"
+
+#include <boost/algorithm/cxx11/all_of.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/range/adaptor/indexed.hpp>
+#include <boost/range/irange.hpp>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#endif
+
+#include "cache.hpp"
+
+// -1 if the file can't be read
+static std::time_t modification_time(const boost::filesystem::path &file) {
+  boost::system::error_code error;
+  const auto time = boost::filesystem::last_write_time(file, error);
+  return error ? -1 : time;
+}
+
+// Every record starts with an F line naming the file and its modification
+// time. A record that was cut off by a crash is dropped when the next F line
+// or the end is reached.
+static void replay(std::istream &input,
+		   const boost::filesystem::path &directory,
+		   Results &results,
+		   std::unordered_map<std::string, std::time_t> &completed) {
+  std::unordered_map<std::string, std::size_t> indices;
+  for (const auto &file : results.files | boost::adaptors::indexed())
+    indices.emplace(file.value(), file.index());
+  std::string line, file, record;
+  std::time_t modified = -1;
+  bool in_record = false;
+  while (std::getline(input, line)) {
+    if (line.empty())
+      continue;
+    if (line[0] == 'F') {
+      std::istringstream stream(line.substr(1));
+      in_record = static_cast<bool>(stream >> std::quoted(file) >> modified);
+      record.clear();
+      continue;
+    }
+    if (!in_record)
+      continue;
+    record += line;
+    record += '\n';
+    if (line[0] != 'E')
+      continue;
+    in_record = false;
+
+    const auto index = indices.find(file);
+    if (index == indices.end() ||
+	modified != modification_time(directory / file))
+      continue;
+    auto &data = results.data[index->second];
+    std::istringstream stream(record);
+    if (!read_record(stream, data, results.signatures, *results.codes))
+      continue;
+    if (boost::algorithm::all_of(data.surm, [](const auto &surm) {
+	  return surm.computed;
+	}))
+      completed[file] = modified;
+  }
+}
+
+Journal::Journal(const boost::filesystem::path &file,
+		 const boost::filesystem::path &directory,
+		 bool resume,
+		 Results &results) :
+  m_file(file), m_directory(directory) {
+  if (resume) {
+    std::ifstream input(file.string());
+    replay(input, directory, results, m_completed);
+  }
+  open(resume ? "a" : "w");
+}
+
+Journal::~Journal() {
+  if (m_output)
+    std::fclose(m_output);
+}
+
+void Journal::open(const char *mode) {
+  m_output = std::fopen(m_file.string().c_str(), mode);
+  // terminate a line that may have been cut off
+  if (m_output) {
+    std::fputc('\n', m_output);
+    std::fflush(m_output);
+  }
+}
+
+bool Journal::completed(const std::string &file) const {
+  const auto modified = modification_time(m_directory / file);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto entry = m_completed.find(file);
+  return entry != m_completed.end() && entry->second == modified;
+}
+
+void Journal::append(const Results &results, const std::size_t index) {
+  const auto &file = results.files[index];
+  const auto slots = boost::irange<std::size_t>(0, results.signatures.size());
+  const auto modified = modification_time(m_directory / file);
+  std::ostringstream record;
+  record << "F " << std::quoted(file) << ' ' << modified << '\n';
+  write_record(record, results.data[index], results.signatures,
+	       *results.codes,
+	       std::vector<std::size_t>(slots.begin(), slots.end()));
+  const auto text = record.str();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_output) {
+    std::fwrite(text.data(), 1, text.size(), m_output);
+    std::fflush(m_output);
+    // a checkpoint that is lost with the power is no checkpoint
+#if __has_include(<unistd.h>)
+    fsync(fileno(m_output));
+#endif
+  }
+  m_completed[file] = modified;
+}
+
+void Journal::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_output)
+    std::fclose(m_output);
+  m_completed.clear();
+  open("w");
+}
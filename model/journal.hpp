@@ -0,0 +1,64 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_JOURNAL_HPP
+#define MODEL_JOURNAL_HPP 1
+
+#include <boost/filesystem/path.hpp>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "batch.hpp"
+
+// Append only checkpoint of the files of a batch that are finished, written
+// as soon as each of them is done so that an interrupted run can be resumed.
+// Files are recorded with their modification time, and a file that has
+// changed since is not completed.
+class Journal {
+  const boost::filesystem::path m_file, m_directory;
+  std::FILE *m_output = nullptr;
+  mutable std::mutex m_mutex;
+  // the modification times of the files completed
+  std::unordered_map<std::string, std::time_t> m_completed;
+
+  void open(const char *mode);
+public:
+  // When resuming, the existing journal is replayed into results, and files
+  // that have every signature become completed. Otherwise it is truncated.
+  // The files of results are relative to directory.
+  Journal(const boost::filesystem::path &file,
+	  const boost::filesystem::path &directory,
+	  bool resume,
+	  Results &results);
+  Journal(const Journal &) = delete;
+  Journal &operator=(const Journal &) = delete;
+  ~Journal();
+  // false if file has been modified since it was completed
+  bool completed(const std::string &file) const;
+  // appends file index of results, and syncs it to the disk
+  void append(const Results &results, std::size_t index);
+  // forgets every file, once nothing is left to resume
+  void clear();
+};
+
+#endif // MODEL_JOURNAL_HPP
@@ -0,0 +1,100 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "mesh_cache.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+MeshFile identify_file(const boost::filesystem::path &file) {
+  boost::system::error_code error;
+  const auto canonical = boost::filesystem::canonical(file, error);
+  if (error)
+    return MeshFile();
+  const auto modified = boost::filesystem::last_write_time(canonical, error);
+  if (error)
+    return MeshFile();
+  return MeshFile{canonical.string(), modified};
+}
+
+std::size_t memory_size(const PreparedMesh &prepared) {
+  const auto &mesh = prepared.mesh;
+  // a point and a halfedge per vertex, four indices per halfedge and one
+  // per face, and roughly as much for the property maps
+  return sizeof(PreparedMesh) +
+    2 * (mesh.number_of_vertices() * (sizeof(Point) + 4) +
+	 mesh.number_of_halfedges() * 16 +
+	 mesh.number_of_faces() * 4);
+}
+
+MeshCache::MeshCache(const std::size_t budget) : m_budget(budget) {}
+
+void MeshCache::evict() {
+  // the most recent one stays even if it is larger than the budget
+  while (m_size > m_budget && m_entries.size() > 1) {
+    m_size -= m_entries.back().size;
+    m_index.erase(m_entries.back().file.path);
+    m_entries.pop_back();
+  }
+}
+
+bool MeshCache::find(const MeshFile &file, CachedMesh &mesh) {
+  if (file.path.empty())
+    return false;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto entry = m_index.find(file.path);
+  if (entry == m_index.end())
+    return false;
+  if (entry->second->file.modified != file.modified) {
+    m_size -= entry->second->size;
+    m_entries.erase(entry->second);
+    m_index.erase(entry);
+    return false;
+  }
+  m_entries.splice(m_entries.begin(), m_entries, entry->second);
+  mesh = entry->second->mesh;
+  return true;
+}
+
+void MeshCache::insert(const MeshFile &file, CachedMesh mesh) {
+  if (file.path.empty())
+    return;
+  const auto size = memory_size(*mesh.mesh);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto entry = m_index.find(file.path);
+  if (entry != m_index.end()) {
+    m_size -= entry->second->size;
+    m_entries.erase(entry->second);
+    m_index.erase(entry);
+  }
+  m_entries.push_front(Entry{file, size, std::move(mesh)});
+  m_index.emplace(file.path, m_entries.begin());
+  m_size += size;
+  evict();
+}
+
+void MeshCache::set_budget(const std::size_t budget) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_budget = budget;
+  evict();
+}
+
+MeshCache &shared_mesh_cache() {
+  static MeshCache cache(std::size_t(1) << 30);
+  return cache;
+}
@@ -0,0 +1,87 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_MESH_CACHE_HPP
+#define MODEL_MESH_CACHE_HPP 1
+
+#include <boost/filesystem/path.hpp>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "cache.hpp"
+#include "prepared_mesh.hpp"
+
+struct CachedMesh {
+  std::shared_ptr<const PreparedMesh> mesh;
+  // only known if it was needed when the mesh was prepared
+  std::optional<ContentHash> hash;
+};
+
+// a version of a file, by its canonical path and modification time
+struct MeshFile {
+  std::string path;
+  std::time_t modified = -1;
+};
+
+// the version of file on the disk now, with an empty path if file is gone
+MeshFile identify_file(const boost::filesystem::path &file);
+
+// Prepared meshes of the files used recently, shared by every tab. A file is
+// identified by its canonical path and modification time, and the least
+// recently used meshes are dropped once their size exceeds the budget.
+class MeshCache {
+  struct Entry {
+    MeshFile file;
+    std::size_t size;
+    CachedMesh mesh;
+  };
+
+  mutable std::mutex m_mutex;
+  // most recently used first
+  std::list<Entry> m_entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+  std::size_t m_size = 0;
+  std::size_t m_budget;
+
+  void evict();
+public:
+  explicit MeshCache(std::size_t budget);
+  MeshCache(const MeshCache &) = delete;
+  MeshCache &operator=(const MeshCache &) = delete;
+
+  // returns false if file is not cached or has been modified since
+  bool find(const MeshFile &file, CachedMesh &mesh);
+  // file has to be identified before mesh is read from it, so that a file
+  // rewritten in the meantime isn't cached with its old contents
+  void insert(const MeshFile &file, CachedMesh mesh);
+  void set_budget(std::size_t budget);
+};
+
+// estimated bytes taken by the mesh
+std::size_t memory_size(const PreparedMesh &prepared);
+
+// the cache of the application, 1 GiB until set_budget is called
+MeshCache &shared_mesh_cache();
+
+#endif // MODEL_MESH_CACHE_HPP
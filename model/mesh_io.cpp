@@ -0,0 +1,235 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "mesh_io.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+// 80 byte header, 32 bit facet count, then 50 bytes per facet
+static constexpr std::size_t stl_header_size = 84;
+static constexpr std::size_t stl_facet_size = 50;
+
+static bool is_space(const char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+namespace {
+  // Text tokens straight from the mapped buffer, optionally skipping the
+  // comments of OFF files.
+  class Scanner {
+    const char *m_position;
+    const char *const m_end;
+    const bool m_comments;
+  public:
+    Scanner(const char *begin, const char *end, bool comments) :
+      m_position(begin), m_end(end), m_comments(comments) {}
+
+    bool at_end() {
+      skip_space();
+      return m_position == m_end;
+    }
+    void skip_space() {
+      while (m_position != m_end) {
+	if (is_space(*m_position))
+	  ++m_position;
+	else if (m_comments && *m_position == '#')
+	  m_position = std::find(m_position, m_end, '\n');
+	else
+	  break;
+      }
+    }
+    std::string_view token() {
+      skip_space();
+      const auto begin = m_position;
+      m_position = std::find_if(m_position, m_end, is_space);
+      return std::string_view(begin, m_position - begin);
+    }
+    void skip_line() {
+      m_position = std::find(m_position, m_end, '\n');
+    }
+    template <typename Number>
+    Number number() {
+      skip_space();
+      // from_chars doesn't accept an explicit plus sign
+      if (m_position != m_end && *m_position == '+')
+	++m_position;
+      Number result;
+      const auto [end, error] = std::from_chars(m_position, m_end, result);
+      if (error != std::errc())
+	throw std::runtime_error("invalid number in mesh");
+      m_position = end;
+      return result;
+    }
+    Point point() {
+      const auto x = number<double>();
+      const auto y = number<double>();
+      const auto z = number<double>();
+      return Point(x, y, z);
+    }
+  };
+}
+
+// whether an STL that starts with "solid" has facets in text
+static bool has_ascii_facets(const char *begin, const char *end) {
+  Scanner scanner(begin, std::min(end, begin + 1024), false);
+  scanner.token();
+  // the name of the solid may take a few tokens
+  while (!scanner.at_end())
+    if (scanner.token() == "facet")
+      return true;
+  return false;
+}
+
+MeshFormat detect_mesh_format(const char *begin, const char *end) {
+  const std::size_t size = end - begin;
+  Scanner scanner(begin, end, false);
+  const auto first = scanner.token();
+  // Binary files may start with "solid" too, so check the size first. Some
+  // exporters add bytes after the facets.
+  if (size >= stl_header_size) {
+    std::uint32_t facets;
+    std::memcpy(&facets, begin + 80, sizeof(facets));
+    const auto facets_size = stl_header_size + stl_facet_size * std::size_t(facets);
+    if (size == facets_size ||
+	(facets > 0 && size > facets_size &&
+	 !(first == "solid" && has_ascii_facets(begin, end))))
+      return MeshFormat::BINARY_STL;
+  }
+  if (first == "solid")
+    return MeshFormat::ASCII_STL;
+  // OFF with optional prefixes like COFF or NOFF, maybe after comments
+  Scanner off_scanner(begin, end, true);
+  const auto keyword = off_scanner.token();
+  if (keyword.size() >= 3 && keyword.substr(keyword.size() - 3) == "OFF")
+    return MeshFormat::OFF;
+  throw std::runtime_error("unknown mesh format");
+}
+
+static void read_binary_stl(const char *begin,
+			    const char *end,
+			    std::vector<Point> &points) {
+  std::uint32_t facets;
+  std::memcpy(&facets, begin + 80, sizeof(facets));
+  // whatever follows the facets is ignored
+  end = std::min(end, begin + stl_header_size + stl_facet_size * std::size_t(facets));
+  points.reserve(points.size() + 3 * facets);
+  for (auto facet = begin + stl_header_size; facet + stl_facet_size <= end;
+       facet += stl_facet_size) {
+    // skip the normal
+    float coordinates[9];
+    std::memcpy(coordinates, facet + 3 * sizeof(float), sizeof(coordinates));
+    for (int vertex = 0; vertex < 3; ++vertex)
+      points.emplace_back(coordinates[3 * vertex],
+			  coordinates[3 * vertex + 1],
+			  coordinates[3 * vertex + 2]);
+  }
+}
+
+static void read_ascii_stl(const char *begin,
+			   const char *end,
+			   std::vector<Point> &points) {
+  // every vertex line is longer than 30 bytes
+  points.reserve(points.size() + (end - begin) / 256 * 3);
+  Scanner scanner(begin, end, false);
+  while (!scanner.at_end())
+    if (scanner.token() == "vertex")
+      points.push_back(scanner.point());
+}
+
+static void read_off(const char *begin,
+		     const char *end,
+		     std::vector<Point> &points) {
+  Scanner scanner(begin, end, true);
+  // The prefixes of the keyword declare the fields after the coordinates,
+  // in the order [ST][C][N][4][n]OFF.
+  auto prefix = scanner.token();
+  prefix.remove_suffix(3);
+  std::size_t extra = 0;
+  bool colors = false, homogeneous = false;
+  if (prefix.substr(0, 2) == "ST") {
+    extra += 2;
+    prefix.remove_prefix(2);
+  }
+  for (const auto c : prefix) {
+    switch (c) {
+    case 'C':
+      colors = true;
+      break;
+    case 'N':
+      extra += 3;
+      break;
+    case '4':
+      homogeneous = true;
+      break;
+    default:
+      throw std::runtime_error("unsupported OFF variant");
+    }
+  }
+  const auto vertices = scanner.number<std::size_t>();
+  // the face and edge counts are not needed
+  scanner.number<std::size_t>();
+  scanner.number<std::size_t>();
+  points.reserve(points.size() + vertices);
+  for (std::size_t vertex = 0; vertex < vertices; ++vertex) {
+    auto point = scanner.point();
+    if (homogeneous) {
+      const auto w = scanner.number<double>();
+      point = Point(point.x() / w, point.y() / w, point.z() / w);
+    }
+    points.push_back(point);
+    // exporters write colors with three or four components, so they end the
+    // line, everything else is a stream of tokens
+    if (colors) {
+      scanner.skip_line();
+    } else {
+      for (std::size_t field = 0; field < extra; ++field)
+	scanner.token();
+    }
+  }
+}
+
+MeshReadStatistics read_points(const char *begin,
+			       const char *end,
+			       std::vector<Point> &points) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto first = points.size();
+  switch (detect_mesh_format(begin, end)) {
+  case MeshFormat::BINARY_STL:
+    read_binary_stl(begin, end, points);
+    break;
+  case MeshFormat::ASCII_STL:
+    read_ascii_stl(begin, end, points);
+    break;
+  case MeshFormat::OFF:
+    read_off(begin, end, points);
+    break;
+  }
+  MeshReadStatistics statistics;
+  statistics.bytes = end - begin;
+  statistics.points = points.size() - first;
+  statistics.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return statistics;
+}
@@ -0,0 +1,61 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_MESH_IO_HPP
+#define MODEL_MESH_IO_HPP 1
+
+#include <cstddef>
+#include <vector>
+
+#include "primitives.hpp"
+
+enum class MeshFormat {
+  BINARY_STL,
+  ASCII_STL,
+  OFF
+};
+
+struct MeshReadStatistics {
+  std::size_t bytes = 0;
+  std::size_t points = 0;
+  double seconds = 0.0;
+
+  // megabytes per second
+  double throughput() const {
+    return seconds > 0.0 ? bytes / seconds / 1e6 : 0.0;
+  }
+  MeshReadStatistics &operator+=(const MeshReadStatistics &other) {
+    bytes += other.bytes;
+    points += other.points;
+    seconds += other.seconds;
+    return *this;
+  }
+};
+
+// throws std::runtime_error if the data is none of the formats
+MeshFormat detect_mesh_format(const char *begin, const char *end);
+
+// Appends the vertices of the mesh in [begin, end) to points, parsing them
+// straight from the buffer. Only the points are read since the convex hull
+// is built from them anyway. The STL formats give three points per facet.
+MeshReadStatistics read_points(const char *begin,
+			       const char *end,
+			       std::vector<Point> &points);
+
+#endif // MODEL_MESH_IO_HPP
@@ -0,0 +1,154 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "prepared_mesh.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "execute.hpp"
+
+// Bump it whenever the layout or the way meshes are prepared changes, so
+// that stale files are prepared again.
+static constexpr std::uint32_t prepared_mesh_version = 1;
+static constexpr char prepared_mesh_magic[8] = {'C', 'O', 'N', 'T', 'M', 'E', 'S', 'H'};
+// files written on a machine of the other byte order are ignored
+static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+namespace {
+  // followed by the points as triples of doubles and the faces as triples
+  // of 32 bit vertex indices
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t points;
+    std::uint64_t faces;
+    double properties[13];
+  };
+}
+
+MeshReadStatistics prepare_mesh(const char *begin,
+				const char *end,
+				PreparedMesh &prepared) {
+  const auto statistics = load_mesh(begin, end, prepared.mesh);
+  prepared.properties = mesh_properties(prepared.mesh);
+  return statistics;
+}
+
+bool read_prepared_mesh(const boost::filesystem::path &file,
+			PreparedMesh &prepared) {
+  boost::system::error_code error;
+  if (!boost::filesystem::exists(file, error))
+    return false;
+  try {
+    const boost::iostreams::mapped_file_source source(file.string());
+    Header header;
+    if (source.size() < sizeof(header))
+      return false;
+    std::memcpy(&header, source.data(), sizeof(header));
+    if (std::memcmp(header.magic, prepared_mesh_magic, sizeof(header.magic)) != 0 ||
+	header.version != prepared_mesh_version ||
+	header.byte_order != byte_order_mark ||
+	source.size() != sizeof(header) + header.points * 3 * sizeof(double) +
+	  header.faces * 3 * sizeof(std::uint32_t))
+      return false;
+
+    auto position = source.data() + sizeof(header);
+    prepared.mesh.clear();
+    prepared.mesh.reserve(header.points, header.faces * 3 / 2, header.faces);
+    for (std::uint64_t point = 0; point < header.points; ++point) {
+      double coordinates[3];
+      std::memcpy(coordinates, position, sizeof(coordinates));
+      position += sizeof(coordinates);
+      prepared.mesh.add_vertex(Point(coordinates[0], coordinates[1], coordinates[2]));
+    }
+    for (std::uint64_t face = 0; face < header.faces; ++face) {
+      std::uint32_t vertices[3];
+      std::memcpy(vertices, position, sizeof(vertices));
+      position += sizeof(vertices);
+      if (vertices[0] >= header.points || vertices[1] >= header.points ||
+	  vertices[2] >= header.points)
+	return false;
+      // an incomplete hull is no hull
+      if (prepared.mesh.add_face(Mesh::Vertex_index(vertices[0]),
+				 Mesh::Vertex_index(vertices[1]),
+				 Mesh::Vertex_index(vertices[2])) == Mesh::null_face()) {
+	prepared.mesh.clear();
+	return false;
+      }
+    }
+    if (prepared.mesh.number_of_faces() != header.faces) {
+      prepared.mesh.clear();
+      return false;
+    }
+    std::copy(std::begin(header.properties), std::end(header.properties),
+	      prepared.properties.begin());
+    return true;
+  } catch (const std::exception &) {
+    return false;
+  }
+}
+
+void write_prepared_mesh(const boost::filesystem::path &file,
+			 const PreparedMesh &prepared) {
+  const auto &mesh = prepared.mesh;
+  Header header;
+  std::memcpy(header.magic, prepared_mesh_magic, sizeof(header.magic));
+  header.version = prepared_mesh_version;
+  header.byte_order = byte_order_mark;
+  header.points = mesh.number_of_vertices();
+  header.faces = mesh.number_of_faces();
+  std::copy(prepared.properties.begin(), prepared.properties.end(),
+	    header.properties);
+
+  boost::system::error_code error;
+  const auto temporary = file.string() + "." +
+    boost::filesystem::unique_path("%%%%%%%%", error).string();
+  if (error)
+    return;
+  {
+    std::ofstream output(temporary, std::ios::binary);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    // the hull was built after collect_garbage, so the indices are dense
+    for (const auto vertex : mesh.vertices()) {
+      const auto &point = mesh.point(vertex);
+      const double coordinates[3] = {point.x(), point.y(), point.z()};
+      output.write(reinterpret_cast<const char *>(coordinates), sizeof(coordinates));
+    }
+    for (const auto face : mesh.faces()) {
+      std::uint32_t vertices[3];
+      auto vertex = std::begin(vertices);
+      for (const auto v : CGAL::vertices_around_face(mesh.halfedge(face), mesh))
+	*vertex++ = static_cast<std::uint32_t>(v);
+      output.write(reinterpret_cast<const char *>(vertices), sizeof(vertices));
+    }
+    if (!output.flush()) {
+      output.close();
+      boost::filesystem::remove(temporary, error);
+      return;
+    }
+  }
+  boost::filesystem::rename(temporary, file, error);
+  if (error)
+    boost::filesystem::remove(temporary, error);
+}
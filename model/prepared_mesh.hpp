@@ -0,0 +1,50 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_PREPARED_MESH_HPP
+#define MODEL_PREPARED_MESH_HPP 1
+
+#include <boost/filesystem/path.hpp>
+#include <array>
+
+#include "mesh_io.hpp"
+#include "primitives.hpp"
+
+// Everything execute needs from a mesh file: the centered convex hull and
+// the properties of it.
+struct PreparedMesh {
+  Mesh mesh;
+  std::array<double, 13> properties;
+};
+
+// parses, centers and hulls the mesh in [begin, end)
+MeshReadStatistics prepare_mesh(const char *begin,
+				const char *end,
+				PreparedMesh &prepared);
+
+// Binary copy of a prepared mesh, read through a memory map. Returns false
+// if the file is missing, truncated or of another version.
+bool read_prepared_mesh(const boost::filesystem::path &file,
+			PreparedMesh &prepared);
+// Written to a temporary file that is then renamed, so that readers never
+// see half of it. Failing to write it is not an error.
+void write_prepared_mesh(const boost::filesystem::path &file,
+			 const PreparedMesh &prepared);
+
+#endif // MODEL_PREPARED_MESH_HPP
@@ -25,6 +25,10 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/reverse_graph.hpp>
 #include <boost/container/flat_set.hpp>
+#include <list>
+#include <vector>
+
+#include "arena.hpp"
 
 using Kernel = CGAL::Simple_cartesian<double>;
 using Point = Kernel::Point_3;
@@ -37,8 +41,32 @@ using Transform = CGAL::Aff_transformation_3<Kernel>;
 struct VertexProperty;
 struct EdgeProperty;
 
-using Graph = boost::adjacency_list<boost::vecS, boost::listS, boost::bidirectionalS,
-				    VertexProperty, EdgeProperty>;
+// like vecS and listS, but allocating from the current arena
+struct arena_vecS {};
+struct arena_listS {};
+
+namespace boost {
+  template <typename T>
+  struct container_gen<arena_vecS, T> {
+    using type = std::vector<T, ArenaAllocator<T>>;
+  };
+  template <typename T>
+  struct container_gen<arena_listS, T> {
+    using type = std::list<T, ArenaAllocator<T>>;
+  };
+  template <>
+  struct parallel_edge_traits<arena_vecS> {
+    using type = allow_parallel_edge_tag;
+  };
+  template <>
+  struct parallel_edge_traits<arena_listS> {
+    using type = allow_parallel_edge_tag;
+  };
+}
+
+using Graph = boost::adjacency_list<arena_vecS, arena_listS, boost::bidirectionalS,
+				    VertexProperty, EdgeProperty, boost::no_property,
+				    arena_listS>;
 using Reverse = boost::reverse_graph<Graph>;
 
 using GraphVertex = boost::graph_traits<Graph>::vertex_descriptor;
@@ -46,9 +74,12 @@ using GraphEdge = boost::graph_traits<Graph>::edge_descriptor;
 using ReverseVertex = boost::graph_traits<Reverse>::vertex_descriptor;
 using ReverseEdge = boost::graph_traits<Reverse>::edge_descriptor;
 
+using VertexSet = boost::container::flat_set<GraphVertex, std::less<GraphVertex>,
+					     ArenaAllocator<GraphVertex>>;
+
 struct VertexProperty {
   double area = 0.0;
-  boost::container::flat_set<GraphVertex> eq_edges;
+  VertexSet eq_edges;
   bool visited = false;
   int id;
   float level;
@@ -70,9 +101,9 @@ struct AArc {
 
 struct EdgeProperty {
   double area_inside = 0.0, area_outside = 0.0;
-  boost::container::flat_set<GraphVertex> roots_inside, roots_outside;
+  VertexSet roots_inside, roots_outside;
   int level = 0;
-  std::list<AArc> arcs;
+  std::list<AArc, ArenaAllocator<AArc>> arcs;
 };
 
 #endif // MODEL_PRIMITIVES_HPP
@@ -0,0 +1,105 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_REEB_HPP
+#define MODEL_REEB_HPP 1
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "primitives.hpp"
+
+// What make_reeb and the encoders need from a level graph, without the areas,
+// root sets and arcs.
+struct ReebVertexProperty {
+  bool visited = false;
+  int id;
+  float level;
+  int label;
+};
+
+struct ReebEdgeProperty {
+  int level = 0;
+};
+
+using ReebGraph = boost::adjacency_list<arena_vecS, arena_listS, boost::bidirectionalS,
+					ReebVertexProperty, ReebEdgeProperty,
+					boost::no_property, arena_listS>;
+using ReebVertex = boost::graph_traits<ReebGraph>::vertex_descriptor;
+
+// Copies the topology and the marks of graph into reeb, overwriting the
+// ids of graph.
+inline void copy_topology(Graph &graph, ReebGraph &reeb) {
+  std::vector<ReebVertex> vertices;
+  vertices.reserve(boost::num_vertices(graph));
+  for (const auto &vertex : boost::make_iterator_range(boost::vertices(graph))) {
+    auto &property = graph[vertex];
+    property.id = vertices.size();
+    vertices.push_back(boost::add_vertex(ReebVertexProperty{property.visited, property.id,
+							    property.level, property.label},
+					 reeb));
+  }
+  for (const auto &edge : boost::make_iterator_range(boost::edges(graph)))
+    boost::add_edge(vertices[graph[boost::source(edge, graph)].id],
+		    vertices[graph[boost::target(edge, graph)].id],
+		    ReebEdgeProperty{graph[edge].level},
+		    reeb);
+}
+
+// The marked graph as bytes, equal for graphs that make the same reeb graph
+// with the same vertex order. Overwrites the ids of graph.
+inline std::string topology_key(Graph &graph) {
+  std::string key;
+  auto append = [&key](const auto value) {
+    char bytes[sizeof(value)];
+    std::memcpy(bytes, &value, sizeof(value));
+    key.append(bytes, sizeof(value));
+  };
+  int id = 0;
+  for (const auto &vertex : boost::make_iterator_range(boost::vertices(graph))) {
+    auto &property = graph[vertex];
+    property.id = id++;
+    append(property.visited);
+    append(property.level);
+  }
+  append(id);
+  for (const auto &edge : boost::make_iterator_range(boost::edges(graph))) {
+    append(graph[boost::source(edge, graph)].id);
+    append(graph[boost::target(edge, graph)].id);
+    append(graph[edge].level);
+  }
+  return key;
+}
+
+struct ReebCodes {
+  std::string reeb;
+  // not every reeb graph has a morse code
+  std::optional<std::string> morse;
+};
+
+// Codes of the marked graphs already encoded, keyed by topology_key. The
+// whole key is compared, so a hash collision can't return a wrong code.
+using EncodingCache = std::unordered_map<std::string, ReebCodes>;
+
+#endif // MODEL_REEB_HPP
@@ -0,0 +1,377 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "runner.hpp"
+
+#include <dependencies.hpp>
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <boost/range/irange.hpp>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+
+#include "admission.hpp"
+#include "cache.hpp"
+#include "execute.hpp"
+#include "journal.hpp"
+#include "mesh_cache.hpp"
+#include "ratios.hpp"
+#ifdef TBB_FOUND
+#include <tbb/task_arena.h>
+// the pipeline moved to a header of its own in oneTBB
+#if __has_include(<tbb/parallel_pipeline.h>)
+#include <tbb/parallel_pipeline.h>
+using filter_mode = tbb::filter_mode;
+#else
+#include <tbb/pipeline.h>
+using filter_mode = tbb::filter;
+#endif
+#endif //TBB_FOUND
+
+SURM &ResultsSaver::slot(const CenterSphereGenerator &center_sphere,
+			 int level_count, double area_ratio,
+			 Aggregation aggregation) {
+  return m_data.surm.at(m_signatures.find(ParameterSignature(
+      center_sphere.ratio, center_sphere.count, level_count, area_ratio,
+      aggregation)));
+}
+
+void ResultsSaver::su(const std::string &filename,
+		      const CenterSphereGenerator &center_sphere,
+		      int level_count, double area_ratio,
+		      Aggregation aggregation, std::pair<float, float> &su) {
+  auto &surm = slot(center_sphere, level_count, area_ratio, aggregation);
+  surm.stable = su.first;
+  surm.unstable = su.second;
+  surm.computed = true;
+}
+
+void ResultsSaver::reeb(const std::string &filename,
+			const CenterSphereGenerator &center_sphere,
+			int level_count, double area_ratio,
+			Aggregation aggregation, const ReebGraph &graph,
+			const std::string &code) {
+  slot(center_sphere, level_count, area_ratio, aggregation).reeb =
+    m_codes.intern(code);
+}
+
+void ResultsSaver::morse(const std::string &filename,
+			 const CenterSphereGenerator &center_sphere,
+			 int level_count, double area_ratio,
+			 Aggregation aggregation, const std::string &code) {
+  slot(center_sphere, level_count, area_ratio, aggregation).morse =
+    m_codes.intern(code);
+}
+
+namespace {
+
+// a file on its way through the stages of a batch
+struct Job {
+  std::size_t index;
+  boost::filesystem::path path;
+  // identified before reading it
+  MeshFile file;
+  CachedMesh cached;
+  bool in_memory = false;
+  std::optional<boost::iostreams::mapped_file_source> source;
+  // only what the result cache doesn't know yet
+  Parameters missing;
+  bool cached_results = false;
+  bool done = false;
+  bool failed = false;
+  MeshReadStatistics statistics;
+  // the peak memory of the file, measured by the computation
+  std::size_t footprint = 0;
+  MemoryGate::Admission admission;
+
+  const boost::iostreams::mapped_file_source &map() {
+    if (!source)
+      source.emplace(path.string());
+    return *source;
+  }
+};
+
+// The I/O stage, the file is only mapped and its pages faulted in here, so
+// that the stages running in parallel don't stall on the disk.
+void read_file(ResultCache *cache, MeshCache *meshes, Job &job) {
+  // a mesh kept in memory needs no reading at all, not even for the hash
+  if (meshes)
+    job.file = identify_file(job.path);
+  job.in_memory = meshes && meshes->find(job.file, job.cached);
+  if (job.in_memory && (!cache || job.cached.hash))
+    return;
+  const auto &source = job.map();
+  volatile char touched = 0;
+  for (std::size_t offset = 0; offset < source.size(); offset += 4096)
+    touched += source.data()[offset];
+}
+
+// parses and hulls the mesh unless a cache had it prepared
+void prepare_file(const Parameters &parameters,
+		  Results &results,
+		  ResultCache *cache,
+		  MeshCache *meshes,
+		  Job &job) {
+  auto &data = results.data[job.index];
+  const auto &signatures = results.signatures;
+
+  if (cache) {
+    if (!job.cached.hash)
+      job.cached.hash = content_hash(job.map().begin(), job.map().end());
+    // The slots may still hold the results of an earlier run, maybe of other
+    // contents, and the cache only fills the ones it knows.
+    std::fill(data.surm.begin(), data.surm.end(), SURM());
+    if (cache->load(*job.cached.hash, data, signatures, *results.codes))
+      job.missing = missing_parameters(parameters, data, signatures);
+    else
+      job.missing = parameters;
+    job.cached_results = true;
+    if (job.missing.empty()) {
+      job.done = true;
+      job.source.reset();
+      return;
+    }
+  }
+
+  if (!job.cached.mesh) {
+    auto prepared = std::make_shared<PreparedMesh>();
+    // the prepared mesh of an earlier run saves parsing and hulling it
+    if (!cache || !cache->load_prepared(*job.cached.hash, *prepared)) {
+      job.statistics = prepare_mesh(job.map().begin(), job.map().end(),
+				    *prepared);
+      if (cache)
+	cache->store_prepared(*job.cached.hash, *prepared);
+    }
+    job.cached.mesh = std::move(prepared);
+  }
+  // again if the hash has just been added
+  if (meshes && (!job.in_memory || job.source))
+    meshes->insert(job.file, job.cached);
+  // the mapping is not needed any more
+  job.source.reset();
+}
+
+void compute_file(const std::string &file,
+		  const Parameters &parameters,
+		  Results &results,
+		  const std::atomic_bool &cancelled,
+		  ResultCache *cache,
+		  Job &job) {
+  if (job.done)
+    return;
+  auto &data = results.data[job.index];
+  const auto &signatures = results.signatures;
+  const auto &to_compute = job.cached_results ? job.missing : parameters;
+
+  const auto &prepared = *job.cached.mesh;
+  const auto &mesh = prepared.mesh;
+  const auto &properties = prepared.properties;
+  data.area = properties[0];
+  data.volume = properties[1];
+  data.a = properties[2];
+  data.b = properties[3];
+  data.c = properties[4];
+  data.proj_circumference = properties[5];
+  data.proj_area = properties[6];
+  data.ratios = calculate_ratios(properties);
+  ResultsSaver saver(data, signatures, *results.codes);
+  const auto workspaces = execute(file, mesh, properties[0], properties[1],
+				  to_compute, saver, cancelled);
+  // the raw points are gone by the time the workspaces are allocated
+  job.footprint = memory_size(prepared) +
+    std::max(job.statistics.points * sizeof(Point), workspaces);
+
+  if (cache && !cancelled)
+    cache->store(*job.cached.hash, data, signatures, *results.codes,
+		 signatures.slots(to_compute));
+}
+
+// 0 for the files that can't be read, they fail fast whenever they come
+std::vector<std::uintmax_t> file_sizes(const boost::filesystem::path &directory,
+				       const std::vector<std::string> &files) {
+  std::vector<std::uintmax_t> sizes(files.size(), 0);
+  for (std::size_t index = 0; index < files.size(); ++index) {
+    boost::system::error_code error;
+    const auto size = boost::filesystem::file_size(directory / files[index],
+						   error);
+    if (!error)
+      sizes[index] = size;
+  }
+  return sizes;
+}
+
+// Most expensive first, so that no big file is left to a single thread at the
+// end. The cost is estimated by the size of the file times the number of
+// parameters to compute, which is the same for all of them.
+std::vector<std::size_t> schedule(const std::vector<std::uintmax_t> &sizes) {
+  std::vector<std::size_t> order(sizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+		   [&sizes](std::size_t a, std::size_t b) {
+		     return sizes[a] > sizes[b];
+		   });
+  return order;
+}
+
+} // namespace
+
+MeshReadStatistics run_batch(const boost::filesystem::path &directory,
+			     const Parameters &parameters,
+			     Results &results,
+			     const StatusCallback &set_status,
+			     const std::atomic_bool &cancelled,
+			     ResultCache *cache,
+			     Journal *journal,
+			     MeshCache *meshes,
+			     std::size_t read_ahead,
+			     MemoryGate *gate) {
+  using boost::irange;
+
+  const auto &files = results.files;
+  for (const auto &index : irange<typename std::vector<std::string>::size_type>(0ul, files.size()))
+    set_status(index, STATUS_WAITING);
+  // written by the stages of the file only
+  std::vector<char> finished(files.size(), false);
+  std::vector<MeshReadStatistics> statistics(files.size());
+
+  const auto sizes = file_sizes(directory, files);
+  const auto order = schedule(sizes);
+  // files wait in the I/O stage until their memory is available
+  FootprintEstimate estimate(parameters);
+#ifdef TBB_FOUND
+  // the files of every batch waiting at the gate run in the same arena
+  const std::size_t threads = tbb::this_task_arena::max_concurrency();
+#else
+  // the batches don't share threads
+  const std::size_t threads = std::numeric_limits<std::size_t>::max();
+#endif //TBB_FOUND
+  std::size_t next = 0;
+  auto next_job = [&]() -> std::shared_ptr<Job> {
+    while (next < order.size() && !cancelled) {
+      const auto index = order[next++];
+      if (journal && journal->completed(files[index])) {
+	set_status(index, STATUS_OK);
+	finished[index] = true;
+	continue;
+      }
+      auto job = std::make_shared<Job>();
+      job->index = index;
+      job->path = directory / files[index];
+      if (gate)
+	job->admission = gate->admit(estimate(sizes[index]), threads);
+      set_status(index, STATUS_RUNNING);
+      return job;
+    }
+    return nullptr;
+  };
+  // a failing file is reported and skipped by the later stages
+  auto attempt = [&](Job &job, const auto &stage) {
+    if (job.failed)
+      return;
+    try {
+      stage(job);
+      return;
+    } catch (const std::exception& e) {
+      std::cerr << files[job.index] << ": " << e.what() << std::endl;
+    } catch (...) {
+      std::cerr << files[job.index] << ": unknown error" << std::endl;
+    }
+    job.failed = true;
+    set_status(job.index, STATUS_ERROR);
+    finished[job.index] = true;
+  };
+  auto read = [&](Job &job) {
+    read_file(cache, meshes, job);
+  };
+  auto prepare = [&](Job &job) {
+    prepare_file(parameters, results, cache, meshes, job);
+  };
+  auto compute = [&](Job &job) {
+    compute_file(files[job.index], parameters, results, cancelled, cache, job);
+    statistics[job.index] = job.statistics;
+    // Only the files that were parsed and computed here are measured. Cached
+    // ones would pull the estimate for the cold files towards 0.
+    if (!cancelled && !job.done && job.statistics.points > 0 &&
+	job.footprint > 0)
+      estimate.measured(sizes[job.index], job.footprint);
+    if (cancelled) {
+      set_status(job.index, STATUS_CANCELLED);
+    } else {
+      if (journal)
+	journal->append(results, job.index);
+      set_status(job.index, STATUS_OK);
+    }
+    finished[job.index] = true;
+  };
+
+#ifdef TBB_FOUND
+  // Files are read one at a time by the first stage, ahead of the ones being
+  // prepared and computed by the other threads. The number of files in
+  // flight, and so the memory taken by their meshes, is bounded by the
+  // number of tokens. The first stage may wait for the memory gate, so the
+  // threads waiting for parallel loops inside the others must not pick it up
+  // and block the files they wait for.
+  const std::size_t tokens =
+    tbb::this_task_arena::max_concurrency() + std::max<std::size_t>(read_ahead, 1);
+  using JobPointer = std::shared_ptr<Job>;
+  tbb::parallel_pipeline(
+      tokens,
+      tbb::make_filter<void, JobPointer>(
+	  filter_mode::serial_in_order,
+	  [&](tbb::flow_control &control) {
+	    auto job = next_job();
+	    if (job)
+	      attempt(*job, read);
+	    else
+	      control.stop();
+	    return job;
+	  }) &
+      tbb::make_filter<JobPointer, JobPointer>(
+	  filter_mode::parallel,
+	  [&](JobPointer job) {
+	    tbb::this_task_arena::isolate([&] { attempt(*job, prepare); });
+	    return job;
+	  }) &
+      tbb::make_filter<JobPointer, void>(
+	  filter_mode::parallel,
+	  [&](JobPointer job) {
+	    tbb::this_task_arena::isolate([&] { attempt(*job, compute); });
+	  }));
+#else
+  while (const auto job = next_job()) {
+    attempt(*job, read);
+    attempt(*job, prepare);
+    attempt(*job, compute);
+  }
+#endif //TBB_FOUND
+
+  // the files that were skipped after cancelling
+  for (const auto &index : irange<typename std::vector<std::string>::size_type>(0ul, files.size()))
+    if (!finished[index])
+      set_status(index, STATUS_CANCELLED);
+
+  MeshReadStatistics total;
+  for (const auto &file : statistics)
+    total += file;
+  return total;
+}
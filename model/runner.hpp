@@ -0,0 +1,98 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_RUNNER_HPP
+#define MODEL_RUNNER_HPP 1
+
+#include <atomic>
+#include <boost/filesystem/path.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "admission.hpp"
+#include "batch.hpp"
+#include "mesh_io.hpp"
+#include "reeb.hpp"
+
+class Journal;
+class MeshCache;
+class ResultCache;
+
+// Saver concept implementation that collects the results of one file of a
+// batch into its slots
+class ResultsSaver {
+  FileResults &m_data;
+  const SignatureTable &m_signatures;
+  CodePool &m_codes;
+
+  SURM &slot(const CenterSphereGenerator &center_sphere,
+	     int level_count,
+	     double area_ratio,
+	     Aggregation aggregation);
+public:
+  ResultsSaver(FileResults &data,
+	       const SignatureTable &signatures,
+	       CodePool &codes) :
+    m_data(data), m_signatures(signatures), m_codes(codes) {}
+
+  // batch files have no room for the arcs of the level graphs
+  static constexpr bool wants_level_graphs = false;
+  // only the codes are stored
+  static constexpr bool wants_reeb_graph = false;
+  void su(const std::string &filename,
+	  const CenterSphereGenerator &center_sphere,
+	  int level_count,
+	  double area_ratio,
+	  Aggregation aggregation,
+	  std::pair<float, float> &su);
+  void reeb(const std::string &filename,
+	    const CenterSphereGenerator &center_sphere,
+	    int level_count,
+	    double area_ratio,
+	    Aggregation aggregation,
+	    const ReebGraph &graph,
+	    const std::string &code);
+  void morse(const std::string &filename,
+	     const CenterSphereGenerator &center_sphere,
+	     int level_count,
+	     double area_ratio,
+	     Aggregation aggregation,
+	     const std::string &code);
+};
+
+using StatusCallback = std::function<void(std::size_t, Status)>;
+
+// parameters has to be a subtree of the signatures of results. set_status is
+// called with the indices of results.files, returns the statistics of reading
+// the meshes summed up. Up to read_ahead files are read while the others are
+// computed, and only as many run at the same time as their estimated memory
+// fits through gate, along with the files of the other batches using it.
+MeshReadStatistics run_batch(const boost::filesystem::path &directory,
+			     const Parameters &parameters,
+			     Results &results,
+			     const StatusCallback &set_status,
+			     const std::atomic_bool &cancelled,
+			     ResultCache *cache = nullptr,
+			     Journal *journal = nullptr,
+			     MeshCache *meshes = nullptr,
+			     std::size_t read_ahead = 2,
+			     MemoryGate *gate = nullptr);
+
+#endif // MODEL_RUNNER_HPP
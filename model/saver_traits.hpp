@@ -0,0 +1,85 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_SAVER_TRAITS_HPP
+#define MODEL_SAVER_TRAITS_HPP 1
+
+#include <boost/property_map/property_map.hpp>
+#include <cstddef>
+#include <type_traits>
+
+#include "primitives.hpp"
+
+// A Saver consumes every output unless it opts out with a member like
+//   static constexpr bool wants_level_graphs = false;
+// and execute() skips the work for the outputs nobody consumes.
+#define SAVER_CAPABILITY(name)						\
+  template <typename Saver, typename = void>				\
+  struct name : std::true_type {};					\
+  template <typename Saver>						\
+  struct name<Saver, std::void_t<decltype(Saver::name)>> :		\
+    std::bool_constant<Saver::name> {};
+
+SAVER_CAPABILITY(wants_level_graphs)
+SAVER_CAPABILITY(wants_reeb)
+SAVER_CAPABILITY(wants_morse)
+// without it the reeb graph passed along with a memoized code may be empty
+SAVER_CAPABILITY(wants_reeb_graph)
+
+#undef SAVER_CAPABILITY
+
+// Takes the place of the arc lists of the edges when nobody draws them.
+struct NullArcList {
+  using value_type = AArc;
+  using iterator = AArc *;
+  using const_iterator = const AArc *;
+
+  template <typename... Args> void emplace_back(Args &&...) {}
+  template <typename... Args> void emplace_front(Args &&...) {}
+  void push_back(const AArc &) {}
+  void push_front(const AArc &) {}
+  template <typename... Args> void splice(Args &&...) {}
+  template <typename... Args> iterator insert(Args &&...) { return nullptr; }
+  void clear() {}
+  iterator begin() { return nullptr; }
+  iterator end() { return nullptr; }
+  const_iterator begin() const { return nullptr; }
+  const_iterator end() const { return nullptr; }
+  bool empty() const { return true; }
+  std::size_t size() const { return 0; }
+};
+
+struct NullArcMap {
+  using key_type = GraphEdge;
+  using value_type = NullArcList;
+  using reference = NullArcList &;
+  using category = boost::lvalue_property_map_tag;
+
+  NullArcList &operator[](const GraphEdge &) const {
+    static thread_local NullArcList list;
+    return list;
+  }
+};
+
+inline NullArcList &get(const NullArcMap &map, const GraphEdge &edge) {
+  return map[edge];
+}
+inline void put(const NullArcMap &, const GraphEdge &, const NullArcList &) {}
+
+#endif // MODEL_SAVER_TRAITS_HPP
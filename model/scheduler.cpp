@@ -0,0 +1,72 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <thread>
+#if __has_include(<tbb/version.h>)
+#include <tbb/version.h>
+#endif
+
+static int scheduler_threads = 0;
+
+#ifdef TBB_FOUND
+// Arenas have priorities since oneTBB, before that the batches are kept off
+// one of the cores instead.
+#if TBB_VERSION_MAJOR >= 2021
+static tbb::task_arena interactive_arena(int threads) {
+  return tbb::task_arena(threads, 1, tbb::task_arena::priority::high);
+}
+static tbb::task_arena background_arena(int threads) {
+  return tbb::task_arena(threads, 1, tbb::task_arena::priority::low);
+}
+#else
+static tbb::task_arena interactive_arena(int threads) {
+  return tbb::task_arena(threads);
+}
+static tbb::task_arena background_arena(int threads) {
+  return tbb::task_arena(std::max(threads - 1, 1));
+}
+#endif
+
+static int concurrency(int threads) {
+  return threads > 0 ? threads
+    : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+}
+
+Scheduler::Scheduler(const int threads) :
+  m_control(threads > 0
+	    ? std::make_unique<tbb::global_control>(
+		tbb::global_control::max_allowed_parallelism, threads)
+	    : nullptr),
+  m_interactive(interactive_arena(concurrency(threads))),
+  m_background(background_arena(concurrency(threads))) {}
+#else
+Scheduler::Scheduler(const int threads) {}
+#endif //TBB_FOUND
+
+void set_scheduler_threads(const int threads) {
+  scheduler_threads = threads;
+}
+
+Scheduler &shared_scheduler() {
+  static Scheduler scheduler(scheduler_threads);
+  return scheduler;
+}
@@ -0,0 +1,64 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_SCHEDULER_HPP
+#define MODEL_SCHEDULER_HPP 1
+
+#include <dependencies.hpp>
+#include <memory>
+#include <utility>
+#ifdef TBB_FOUND
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+#endif //TBB_FOUND
+
+enum class Priority { INTERACTIVE, BACKGROUND };
+
+// The worker threads of the application, shared by all tabs. The threads of
+// the tabs only wait for their requests and hand the work over, so opening
+// many tabs or running several batches doesn't oversubscribe the CPU, and
+// the work of a single file goes before the batches.
+class Scheduler {
+#ifdef TBB_FOUND
+  std::unique_ptr<tbb::global_control> m_control;
+  tbb::task_arena m_interactive, m_background;
+#endif //TBB_FOUND
+public:
+  // all cores if threads is 0
+  explicit Scheduler(int threads);
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  // runs function on the workers and returns its result once it is done
+  template <typename Function>
+  decltype(auto) run(const Priority priority, Function &&function) {
+#ifdef TBB_FOUND
+    auto &arena = priority == Priority::INTERACTIVE ? m_interactive : m_background;
+    return arena.execute(std::forward<Function>(function));
+#else
+    return std::forward<Function>(function)();
+#endif //TBB_FOUND
+  }
+};
+
+// has to be called before the scheduler is used first
+void set_scheduler_threads(int threads);
+Scheduler &shared_scheduler();
+
+#endif // MODEL_SCHEDULER_HPP
@@ -0,0 +1,72 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_STATUS_BOARD_HPP
+#define MODEL_STATUS_BOARD_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "batch.hpp"
+
+// The statuses of the files of a batch. The workers write them without locks
+// or events, and a single reader collects the ones that have changed since it
+// last looked, as often as it likes.
+class StatusBoard {
+  // no status yet, so that the first look reports every file
+  static constexpr std::uint8_t UNKNOWN = 0xff;
+
+  std::unique_ptr<std::atomic<std::uint8_t>[]> m_statuses;
+  std::size_t m_size = 0;
+  std::atomic_bool m_changed = false;
+  // what the reader has seen, touched by the reader only
+  std::vector<std::uint8_t> m_seen;
+public:
+  // not while the statuses are written or read
+  void reset(const std::size_t size) {
+    m_statuses.reset(new std::atomic<std::uint8_t>[size]);
+    for (std::size_t index = 0; index < size; ++index)
+      m_statuses[index].store(UNKNOWN, std::memory_order_relaxed);
+    m_size = size;
+    m_seen.assign(size, UNKNOWN);
+    m_changed = false;
+  }
+  void set(const std::size_t index, const Status status) {
+    m_statuses[index].store(status, std::memory_order_relaxed);
+    m_changed.store(true, std::memory_order_release);
+  }
+  // calls function with the index and status of the changed files
+  template <typename Function>
+  void changes(Function &&function) {
+    if (!m_changed.exchange(false, std::memory_order_acquire))
+      return;
+    for (std::size_t index = 0; index < m_size; ++index) {
+      const auto status = m_statuses[index].load(std::memory_order_relaxed);
+      if (status != m_seen[index]) {
+	m_seen[index] = status;
+	function(index, static_cast<Status>(status));
+      }
+    }
+  }
+};
+
+#endif // MODEL_STATUS_BOARD_HPP
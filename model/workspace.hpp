@@ -0,0 +1,197 @@
+/*
+  Copyright 2019 Balázs Ludmány
+
+  This file is part of contours-viewer.
+
+  contours-viewer is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  contours-viewer is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with contours-viewer.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_WORKSPACE_HPP
+#define MODEL_WORKSPACE_HPP 1
+
+#include <boost/container/flat_map.hpp>
+#include <boost/property_map/property_map.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#include "primitives.hpp"
+
+// Per halfedge records of the contour levels, sorted by level. Each row is a
+// contiguous flat_map, and the rows keep their capacity when the table is
+// reset, so refilling it for the next center or level count doesn't allocate.
+template <typename T>
+class IntersectionTable {
+public:
+  using Row = boost::container::flat_map<int, T>;
+private:
+  std::vector<Row> m_rows;
+public:
+  void reset(const Mesh &mesh) {
+    if (m_rows.size() < mesh.num_halfedges())
+      m_rows.resize(mesh.num_halfedges());
+    for (auto &row : m_rows)
+      row.clear();
+  }
+  // make room for as many levels as each halfedge crosses
+  void reserve(const Mesh &mesh,
+	       const std::vector<double> &distances,
+	       const double min_distance,
+	       const double step) {
+    for (const auto halfedge : mesh.halfedges()) {
+      const auto source = std::floor((distances[mesh.source(halfedge)] - min_distance) / step);
+      const auto target = std::floor((distances[mesh.target(halfedge)] - min_distance) / step);
+      m_rows[halfedge].reserve(static_cast<std::size_t>(std::abs(target - source)));
+    }
+  }
+  // Keep every factor-th level of finer. Levels are numbered by the multiple
+  // of the step above the minimal distance, so if the step of this table is
+  // factor times the step of finer, level l here is level factor * l there.
+  void derive(const IntersectionTable &finer, const int factor) {
+    if (m_rows.size() < finer.m_rows.size())
+      m_rows.resize(finer.m_rows.size());
+    for (std::size_t halfedge = 0; halfedge < finer.m_rows.size(); ++halfedge) {
+      auto &row = m_rows[halfedge];
+      row.clear();
+      for (const auto &[level, value] : finer.m_rows[halfedge])
+	if (level % factor == 0)
+	  row.emplace_hint(row.end(), level / factor, value);
+    }
+  }
+  Row &operator[](const std::size_t halfedge) {
+    return m_rows[halfedge];
+  }
+  std::size_t memory_size() const {
+    std::size_t size = m_rows.capacity() * sizeof(Row);
+    for (const auto &row : m_rows)
+      size += row.capacity() * sizeof(typename Row::value_type);
+    return size;
+  }
+  auto map(const Mesh &mesh) {
+    return boost::make_iterator_property_map(m_rows.begin(),
+					     CGAL::get(boost::halfedge_index, mesh));
+  }
+};
+
+// Distances of the vertices from center, indexed by vertex. A plain loop over
+// the contiguous point array, vectorized at -O3 with -fno-math-errno.
+inline void distance_field(const Mesh &mesh,
+			   const Point &center,
+			   std::vector<double> &distances) {
+  const auto &points = mesh.points();
+  distances.resize(mesh.num_vertices());
+  std::transform(points.begin(), points.end(), distances.begin(),
+		 [cx = center.x(), cy = center.y(), cz = center.z()](const Point &point) {
+		   const double dx = point.x() - cx;
+		   const double dy = point.y() - cy;
+		   const double dz = point.z() - cz;
+		   return std::sqrt(dx * dx + dy * dy + dz * dz);
+		 });
+}
+
+// the tables that execute() needs for one center at a time
+struct Workspace {
+  std::vector<double> distances;
+  // of the finest level count of the nesting chain running at the moment
+  IntersectionTable<std::pair<Point, Point>> finest_intersections;
+  IntersectionTable<std::pair<Point, Point>> derived_intersections;
+  IntersectionTable<GraphVertex> to_halfedge, from_halfedge;
+  // backs the level graph, reset after every level count
+  Arena arena;
+
+  // the tables only grow, so this is the most they have taken
+  std::size_t memory_size() const {
+    return distances.capacity() * sizeof(double) +
+      finest_intersections.memory_size() +
+      derived_intersections.memory_size() + to_halfedge.memory_size() +
+      from_halfedge.memory_size() + arena.capacity();
+  }
+};
+
+// For every level count the finest level count whose levels include its own,
+// possibly itself. With step = range / (count + 1), that is the case when
+// count + 1 divides the other count + 1.
+template <typename LevelCounts>
+std::vector<std::size_t> finest_nesting(const LevelCounts &level_counts) {
+  std::vector<std::size_t> sources(level_counts.size());
+  for (std::size_t index = 0; index < level_counts.size(); ++index) {
+    sources[index] = index;
+    for (std::size_t other = 0; other < level_counts.size(); ++other)
+      if ((level_counts[other].value + 1) % (level_counts[index].value + 1) == 0 &&
+	  level_counts[other].value > level_counts[sources[index]].value)
+	sources[index] = other;
+  }
+  return sources;
+}
+
+// The indices of the level counts grouped by their sources, so that each
+// source is followed by the level counts nested into it.
+inline std::vector<std::size_t> nesting_order(const std::vector<std::size_t> &sources) {
+  std::vector<std::size_t> order(sources.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+		   [&sources](std::size_t a, std::size_t b) {
+		     return sources[a] < sources[b];
+		   });
+  return order;
+}
+
+// Hands out workspaces to the tasks and takes them back, so there are only
+// as many of them as tasks running at the same time.
+template <typename T>
+class Pool {
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<T>> m_free;
+public:
+  class Handle {
+    Pool *m_pool;
+    std::unique_ptr<T> m_object;
+  public:
+    Handle(Pool *pool, std::unique_ptr<T> object) :
+      m_pool(pool), m_object(std::move(object)) {}
+    Handle(Handle &&) = default;
+    ~Handle() {
+      if (m_object) {
+	std::lock_guard<std::mutex> lock(m_pool->m_mutex);
+	m_pool->m_free.push_back(std::move(m_object));
+      }
+    }
+    T &operator*() const { return *m_object; }
+    T *operator->() const { return m_object.get(); }
+  };
+
+  // of the objects that are not in use
+  std::size_t memory_size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::size_t size = 0;
+    for (const auto &object : m_free)
+      size += object->memory_size();
+    return size;
+  }
+
+  Handle acquire() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free.empty())
+      return Handle(this, std::make_unique<T>());
+    auto object = std::move(m_free.back());
+    m_free.pop_back();
+    return Handle(this, std::move(object));
+  }
+};
+
+#endif // MODEL_WORKSPACE_HPP
@@ -36,7 +36,9 @@
 #endif //VTK_FOUND
 #include "outputview.hpp"
 #include "model/execute.hpp"
+#include "model/mesh_cache.hpp"
 #include "model/ratios.hpp"
+#include "model/scheduler.hpp"
 
 wxDEFINE_EVENT(wxEVT_SINGLEFILE_LOADED, wxThreadEvent);
 wxDEFINE_EVENT(wxEVT_SINGLEFILE_COMPUTED, wxThreadEvent);
@@ -97,21 +99,40 @@ void SingleFile::Initialize() {
   
   Bind(wxEVT_SINGLEFILE_LOADED, &SingleFile::OnLoaded, this);
   Bind(wxEVT_SINGLEFILE_COMPUTED, &SingleFile::OnComputed, this);
+}
 
-  if (CreateThread(wxTHREAD_JOINABLE) == wxTHREAD_NO_ERROR)
+// tabs that are never shown don't need a thread
+void SingleFile::StartThread() {
+  if (!GetThread() && CreateThread(wxTHREAD_JOINABLE) == wxTHREAD_NO_ERROR)
     GetThread()->Run();
+}
 
+void SingleFile::Activate() {
+  if (m_activated)
+    return;
+  m_activated = true;
+  StartThread();
   m_queue.Post({LOAD, std::nullopt});
 }
 
+// only fills the mesh cache, the views are prepared by Activate
+void SingleFile::Prefetch() {
+  if (m_prefetched || m_activated)
+    return;
+  m_prefetched = true;
+  StartThread();
+  m_queue.Post({PREFETCH, std::nullopt});
+}
+
 void SingleFile::Compute() {
+  m_cancelled = false;
   m_queue.Post({RUN, m_input_form->GetParameters()});
   SetRunning();
 }
 
+// OnComputed will stop running once execute has noticed it
 void SingleFile::Cancel() {
   m_cancelled = true;
-  SetRunning(false);
 }
 
 void SingleFile::Save() {
@@ -161,28 +182,52 @@ bool SingleFile::Cancelled() const {
   return m_cancelled;
 }
 
+// the prepared mesh of file, shared with the other tabs that have it open
+static std::shared_ptr<const PreparedMesh>
+find_or_prepare(const std::string &file, const Priority priority) {
+  const auto identity = identify_file(file);
+  CachedMesh cached;
+  if (!shared_mesh_cache().find(identity, cached)) {
+    const boost::iostreams::mapped_file_source source(file);
+    auto mesh = std::make_shared<PreparedMesh>();
+    shared_scheduler().run(priority, [&] {
+      prepare_mesh(source.begin(), source.end(), *mesh);
+    });
+    cached.mesh = std::move(mesh);
+    shared_mesh_cache().insert(identity, cached);
+  }
+  return cached.mesh;
+}
+
 wxThread::ExitCode SingleFile::Entry() {
-  Mesh mesh;
-  double area = 0.0, volume = 0.0;
+  std::shared_ptr<const PreparedMesh> prepared;
   std::pair<Event, std::optional<Parameters> > event;
   while (m_queue.Receive(event) == wxMSGQUEUE_NO_ERROR) {
     switch (event.first) {
+    case PREFETCH:
+      // a broken file is reported when its tab is shown
+      try {
+	find_or_prepare(m_fileName, Priority::BACKGROUND);
+      } catch (...) {}
+      break;
     case LOAD: {
-      load_mesh(m_fileName, mesh);
-      const auto properties = mesh_properties(mesh);
+      prepared = find_or_prepare(m_fileName, Priority::INTERACTIVE);
+      const auto &properties = prepared->properties;
       const auto ratios = calculate_ratios(properties);
-      area = properties[0];
-      volume = properties[1];
       m_output_view->UpdateMeshData(properties);
       m_output_view->UpdateRatios(ratios);
 #ifdef VTK_FOUND
-      m_mesh_view->PrepareMesh(mesh);
+      m_mesh_view->PrepareMesh(prepared->mesh);
 #endif //VTK_FOUND
       wxQueueEvent(GetEventHandler(), new wxThreadEvent(wxEVT_SINGLEFILE_LOADED));
       break;
     }
     case RUN:
-      execute(m_fileName, mesh, area, volume, *(event.second), *this);
+      if (prepared)
+	shared_scheduler().run(Priority::INTERACTIVE, [&] {
+	  execute(m_fileName, prepared->mesh, prepared->properties[0],
+		  prepared->properties[1], *(event.second), *this, m_cancelled);
+	});
       wxQueueEvent(GetEventHandler(), new wxThreadEvent(wxEVT_SINGLEFILE_COMPUTED));
       break;
     case EXIT:
@@ -206,6 +251,11 @@ void SingleFile::OnLoaded(wxThreadEvent & WXUNUSED(event)) {
 }
 
 void SingleFile::OnComputed(wxThreadEvent & WXUNUSED(event)) {
+  // the prepared data is incomplete
+  if (Cancelled()) {
+    SetRunning(false);
+    return;
+  }
 #ifdef VTK_FOUND
   m_mesh_view->SwapArcs();
   m_graph_view->Swap();
@@ -220,8 +270,10 @@ void SingleFile::OnComputed(wxThreadEvent & WXUNUSED(event)) {
 
 bool SingleFile::Destroy() {
   Cancel();
-  m_queue.Post({EXIT, std::nullopt});
-  GetThread()->Delete(nullptr, wxTHREAD_WAIT_BLOCK);
+  if (GetThread()) {
+    m_queue.Post({EXIT, std::nullopt});
+    GetThread()->Delete(nullptr, wxTHREAD_WAIT_BLOCK);
+  }
   m_manager.UnInit();
   return wxWindow::Destroy();
 }
@@ -257,7 +309,7 @@ void SingleFile::reeb(const std::string &filename,
 		      int level_count,
 		      double area_ratio,
 		      Aggregation aggregation,
-		      const Graph &graph,
+		      const ReebGraph &graph,
 		      const std::string &code) {
 #ifdef VTK_FOUND
   m_graph_view->UpdateGraph(graph);
@@ -25,6 +25,7 @@
 #include <wx/msgqueue.h>
 #include "computable.hpp"
 #include "model/parameters.hpp"
+#include "model/reeb.hpp"
 #include <dependencies.hpp>
 
 class InputForm;
@@ -52,6 +53,7 @@ class SingleFile final : public wxWindow, public wxThreadHelper, public Computab
   //Parameters m_parameters;
 
   enum Event {
+    PREFETCH,
     LOAD,
     RUN,
     EXIT
@@ -59,8 +61,10 @@ class SingleFile final : public wxWindow, public wxThreadHelper, public Computab
   wxMessageQueue<std::pair<Event, std::optional<Parameters> > > m_queue;
 
   std::atomic_bool m_cancelled = false;
+  bool m_prefetched = false, m_activated = false;
 
   void Initialize();
+  void StartThread();
   wxThread::ExitCode Entry() final;
   void OnLoaded(wxThreadEvent &event);
   void OnComputed(wxThreadEvent &event);
@@ -76,6 +80,8 @@ public:
   void Compute() final;
   void Cancel() final;
   void Save() final;
+  void Activate() final;
+  void Prefetch() final;
   bool Destroy() final;
   virtual ~SingleFile() {}
 
@@ -100,7 +106,7 @@ public:
 	    int level_count,
 	    double area_ratio,
 	    Aggregation aggregation,
-	    const Graph &graph,
+	    const ReebGraph &graph,
 	    const std::string &code);
   void morse(const std::string &filename,
 	     const CenterSphereGenerator &center_sphere,
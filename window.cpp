@@ -28,14 +28,19 @@
 
 #include <wx/aui/aui.h>
 #include <wx/artprov.h>
+#include <wx/config.h>
 #include <wx/stdpaths.h>
 #include <wx/wupdlock.h>
 #include <wx/sysopt.h>
 
 #include "singlefile.hpp"
 #include "batchfile.hpp"
+#include "model/mesh_cache.hpp"
+#include "model/scheduler.hpp"
 
 static const wxWindowID NotebookID = wxID_HIGHEST + 1;
+// the tabs on each side of the current one that are loaded in advance
+static const std::size_t PrefetchDistance = 2;
 
 class Application final : public wxApp {
   bool OnInit() final;
@@ -50,6 +55,7 @@ class MainWindow final : public wxFrame {
 	void OnCancel(wxCommandEvent &event);
 	void OnRunningChanged();
 	void OnTabChanged(wxAuiNotebookEvent &event);
+	void LoadAround(std::size_t page);
 public:
 	template <typename... Args>
 	explicit MainWindow(Args&&... args) :
@@ -64,6 +70,12 @@ bool Application::OnInit() {
 #ifdef wxOSX_FILEDIALOG_ALWAYS_SHOW_TYPES
   wxSystemOptions::SetOption(wxOSX_FILEDIALOG_ALWAYS_SHOW_TYPES,1);
 #endif
+  // the worker threads shared by the tabs, all cores by default
+  set_scheduler_threads(wxConfigBase::Get()->ReadLong("Threads", 0));
+  // MB of prepared meshes kept between runs and shared by the tabs
+  const auto mesh_cache = wxConfigBase::Get()->ReadLong("MeshCache", 1024);
+  if (mesh_cache >= 0)
+    shared_mesh_cache().set_budget(static_cast<std::size_t>(mesh_cache) << 20);
   auto window = new MainWindow(nullptr, wxID_ANY, "Contours viewer");
   window->SetEventHandler(window);
   window->Show(true);
@@ -118,25 +130,47 @@ void MainWindow::OnOpen(wxCommandEvent & WXUNUSED(event)) {
   dialog.GetPaths(paths);
   dialog.GetFilenames(filenames);
   wxWindowUpdateLocker lock(tabBar);
+  // the tabs load when they are shown, the first one of them is
+  const auto first = tabBar->GetPageCount();
   switch(dialog.GetFilterIndex()) {
   case 0:
     for (std::size_t i = 0; i < paths.GetCount(); ++i) {
 	  auto tab = new SingleFile(paths[i], tabBar, wxID_ANY);
 	  tab->SetRunningChanged(std::bind(&MainWindow::OnRunningChanged, this));
-      tabBar->AddPage(tab, filenames[i], true);
+      tabBar->AddPage(tab, filenames[i], false);
 	}
     break;
   default:
     for (std::size_t i = 0; i < paths.GetCount(); ++i) {
 	  auto tab = new BatchFile(paths[i], tabBar, wxID_ANY);
 	  tab->SetRunningChanged(std::bind(&MainWindow::OnRunningChanged, this));
-      tabBar->AddPage(tab, filenames[i], true);
+      tabBar->AddPage(tab, filenames[i], false);
 	}
   }
+  if (tabBar->GetPageCount() > first) {
+    tabBar->SetSelection(first);
+    LoadAround(first);
+  }
   GetToolBar()->EnableTool(wxID_EXECUTE, false);
   GetMenuBar()->Enable(wxID_EXECUTE, false);
 }
 
+void MainWindow::LoadAround(const std::size_t page) {
+  const auto count = tabBar->GetPageCount();
+  if (page >= count)
+    return;
+  if (auto tab = dynamic_cast<Computable *>(tabBar->GetPage(page)))
+    tab->Activate();
+  for (std::size_t distance = 1; distance <= PrefetchDistance; ++distance) {
+    if (page + distance < count)
+      if (auto tab = dynamic_cast<Computable *>(tabBar->GetPage(page + distance)))
+	tab->Prefetch();
+    if (page >= distance)
+      if (auto tab = dynamic_cast<Computable *>(tabBar->GetPage(page - distance)))
+	tab->Prefetch();
+  }
+}
+
 void MainWindow::OnSave(wxCommandEvent & WXUNUSED(event)) {
   auto file = dynamic_cast<Computable *>(tabBar->GetCurrentPage());
   if (file)
@@ -166,6 +200,8 @@ void MainWindow::OnRunningChanged() {
 }
 
 void MainWindow::OnTabChanged(wxAuiNotebookEvent &event) {
+  if (event.GetSelection() != wxNOT_FOUND)
+    LoadAround(event.GetSelection());
   auto tab = dynamic_cast<Computable *>(tabBar->GetCurrentPage());
   GetToolBar()->EnableTool(wxID_EXECUTE, !tab->Running());
   GetToolBar()->EnableTool(wxID_CANCEL, tab->Running());